@@ -0,0 +1,53 @@
+# Find LuaJIT
+#
+# Finds the LuaJIT headers and library.
+# LuaJIT implements the Lua 5.1 C API, so the bindings built for Lua 5.1
+# work unchanged with it, and scripts additionally get access to the FFI.
+#
+# This module defines
+# LUAJIT_FOUND       - LuaJIT was found
+# LUAJIT_INCLUDE_DIR - Directory containing lua.h and luajit.h
+# LUAJIT_LIBRARY     - The LuaJIT library
+# LUAJIT_LIBRARIES   - Libraries required by CMake convention (LuaJIT + libm on Unix)
+
+# Don't be verbose if previously run successfully
+IF(LUAJIT_INCLUDE_DIR AND LUAJIT_LIBRARY)
+    SET(LUAJIT_FIND_QUIETLY TRUE)
+ENDIF(LUAJIT_INCLUDE_DIR AND LUAJIT_LIBRARY)
+
+# Search for header files
+FIND_PATH(LUAJIT_INCLUDE_DIR luajit.h
+    HINTS
+        ENV LUAJIT_DIR
+    PATH_SUFFIXES include/luajit-2.1 include/luajit-2.0 luajit-2.1 luajit-2.0 include
+    PATHS
+        /usr
+        /usr/local
+        /opt/local
+        /opt)
+
+# Search for library
+FIND_LIBRARY(LUAJIT_LIBRARY
+    NAMES luajit-5.1 luajit
+    HINTS
+        ENV LUAJIT_DIR
+    PATH_SUFFIXES lib lib64
+    PATHS
+        /usr
+        /usr/local
+        /opt/local
+        /opt)
+
+IF(LUAJIT_LIBRARY)
+    IF(UNIX AND NOT APPLE)
+        FIND_LIBRARY(LUAJIT_MATH_LIBRARY m)
+        SET(LUAJIT_LIBRARIES ${LUAJIT_LIBRARY} ${LUAJIT_MATH_LIBRARY})
+    ELSE()
+        SET(LUAJIT_LIBRARIES ${LUAJIT_LIBRARY})
+    ENDIF()
+ENDIF(LUAJIT_LIBRARY)
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LuaJIT DEFAULT_MSG LUAJIT_LIBRARY LUAJIT_INCLUDE_DIR)
+
+MARK_AS_ADVANCED(LUAJIT_INCLUDE_DIR LUAJIT_LIBRARY LUAJIT_MATH_LIBRARY)
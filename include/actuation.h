@@ -0,0 +1,67 @@
+#ifndef JAKOPTER_ACTUATION_H
+#define JAKOPTER_ACTUATION_H
+
+/**
+* Online identification of the drone's response to movement commands.
+* Each step of a PCMD setpoint, timed when the command leaves send_cmd, is matched
+* with the response seen in the navdata that follow :
+*	roll -> roll angle, pitch -> pitch angle (degrees),
+*	vertical speed -> climb rate (mm/s), angular speed -> yaw rate (degrees/s).
+* The response is fitted as a first-order system with dead time, from the times
+* it crosses 10% and 63% of its final change. Times are taken on the host, from the
+* command's departure to the navdata's arrival, so the dead time includes both
+* directions of the link. The last ACTUATION_WINDOW steps of each axis are kept,
+* and their medians are published in CHANNEL_ACTUATION, laid out as a
+* jakopter_actuation_channel_t (see com_layouts.h).
+*/
+
+#include "common.h"
+#include "com_layouts.h"
+
+//number of identified steps kept per axis
+#define ACTUATION_WINDOW 8
+//smallest setpoint change that is analyzed
+#define ACTUATION_MIN_STEP 0.05f
+//how long the response to a step is watched, in ms, unless the setpoint changes again
+#define ACTUATION_EPISODE 1500
+//shortest watch that can give an estimation, in ms
+#define ACTUATION_MIN_EPISODE 600
+//maximum number of navdata samples in a watch
+#define ACTUATION_MAX_SAMPLES 64
+//size of the com channel
+#define ACTUATION_COM_SIZE sizeof(jakopter_actuation_channel_t)
+
+/**
+* \brief Get the current estimation for an axis.
+* \param axis one of the jakopter_actuation_axis values.
+* \param estimation where to copy it.
+* \returns the number of steps it's based on, -1 if the axis is invalid.
+*/
+int jakopter_actuation_get(int axis, jakopter_actuation_t* estimation);
+
+/**
+* \brief Forget every step, and create CHANNEL_ACTUATION. Called when the navdata start.
+*/
+void actuation_init();
+
+/**
+* \brief Remove CHANNEL_ACTUATION. Called when the navdata stop.
+*/
+void actuation_clean();
+
+/**
+* \brief Record the movement setpoint that has just been sent. Called by send_cmd for each PCMD.
+* \param host_time time of the sending, from jakopter_clock_host_now.
+* \param setpoint the 4 speeds, in jakopter_move's order.
+*/
+void actuation_add_command(double host_time, const float setpoint[ACTUATION_NB_AXES]);
+
+/**
+* \brief Record the drone's state from a demo navdata packet.
+* \param host_time time of the reception, from jakopter_clock_host_now.
+* \param theta, phi, psi angles in milli-degrees.
+* \param altitude in mm.
+*/
+void actuation_add_navdata(double host_time, float theta, float phi, float psi, int altitude);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef JAKOPTER_CLOCK_SYNC_H
+#define JAKOPTER_CLOCK_SYNC_H
+
+/**
+* Estimation of the relation between the drone's clock and the host's
+* CLOCK_MONOTONIC, from the arrival times of the drone's packets :
+*	host_time = drone_time + offset + drift * (drone_time - reference)
+* Network jitter only ever delays packets, so only the fastest packet of
+* each window is kept, and a line is fitted through those minimums.
+* The navdata don't answer anything the host sends, so there's no round trip
+* to split the one-way delay from the offset : the offset includes the delay
+* of the fastest packets, and converted drone times are the earliest host time
+* at which a packet sent then could have arrived.
+*/
+
+#include "common.h"
+
+//length of a filtering window, in milliseconds of drone time
+#define CLOCK_SYNC_WINDOW 1000
+//number of windows the fit is made on
+#define CLOCK_SYNC_NB_WINDOWS 60
+//minimum number of windows before the estimation is considered valid
+#define CLOCK_SYNC_MIN_WINDOWS 3
+/*
+* A drone time going back by more than this, in ms, means the drone's clock
+* was reset (reboot), and restarts the estimation. Smaller steps back are
+* reordered packets, which are ignored.
+*/
+#define CLOCK_SYNC_RESET_JUMP 2000
+/*
+* Drone time of a navdata packet is computed from its sequence number,
+* the drone sending them at 15 Hz in demo mode. An error on that period
+* ends up in the drift.
+*/
+#define CLOCK_SYNC_NAVDATA_PERIOD (1000.0/15)
+
+/**
+* \brief Current host time, from CLOCK_MONOTONIC.
+* \returns the time in milliseconds.
+*/
+double jakopter_clock_host_now();
+
+/**
+* \brief Add a timing sample : a packet stamped with the given drone time
+*		was received at the given host time.
+*		A drone time lower than the newest one is ignored, unless it's lower
+*		by more than CLOCK_SYNC_RESET_JUMP : the drone's clock was then reset,
+*		and the estimation restarts.
+* \param drone_time in milliseconds, in the drone's time base.
+* \param host_time in milliseconds, from jakopter_clock_host_now.
+*/
+void clock_sync_add_sample(double drone_time, double host_time);
+
+/**
+* \brief Forget every sample, e.g. when the connection is restarted.
+*/
+void clock_sync_reset();
+
+/**
+* \brief Get the current estimation.
+* \param offset receives host_time - drone_time at the last sample, in ms. Can be NULL.
+* \param drift receives the relative drift of the drone's clock (ms per ms). Can be NULL.
+* \param bound receives the uncertainty on converted times, in ms, not counting
+*		the delay of the fastest packets, which is part of the offset. Can be NULL.
+* \returns 0 if the estimation is valid, -1 if there are not enough samples yet.
+*/
+int jakopter_clock_get_sync(double* offset, double* drift, double* bound);
+
+/**
+* \brief Convert a drone time to the host's time base.
+* \returns the host time in ms, or -1 if the estimation isn't valid yet.
+*/
+double jakopter_clock_drone_to_host(double drone_time);
+
+/**
+* \brief Convert a host time to the drone's time base.
+* \returns the drone time in ms, or -1 if the estimation isn't valid yet.
+*/
+double jakopter_clock_host_to_drone(double host_time);
+
+#endif
@@ -69,6 +69,33 @@ char jakopter_com_read_char(jakopter_com_channel_t* cc, size_t offset);
 void* jakopter_com_read_buf(jakopter_com_channel_t* cc, size_t offset, size_t size, void* dest);
 
 
+/*******************************************************************
+********Direct access to the channel's buffer***********************
+*For callers that know the channel's layout (see com_layouts.h) and
+*want to read or write several fields in one go, without a copy.
+*The size must be checked once with jakopter_com_get_size.
+********************************************************************/
+
+/**
+* \brief Lock the channel and give access to its buffer.
+*		Nothing else can use the channel until jakopter_com_unlock is called,
+*		so keep it short.
+* \returns the buffer, NULL if cc is NULL (the channel isn't locked then).
+*/
+void* jakopter_com_lock(jakopter_com_channel_t* cc);
+
+/**
+* \brief Unlock a channel locked by jakopter_com_lock.
+* \param written non-zero if the buffer was modified, to update the timestamp.
+*/
+void jakopter_com_unlock(jakopter_com_channel_t* cc, int written);
+
+/**
+* \brief Size of the channel's buffer in bytes, fixed at its creation. 0 if cc is NULL.
+*/
+size_t jakopter_com_get_size(jakopter_com_channel_t* cc);
+
+
 /**
 * \brief Get the timestamp, in milliseconds, of the last write operation
 *		performed on a given com channel.
@@ -0,0 +1,110 @@
+#ifndef JAKOPTER_COM_LAYOUTS_H
+#define JAKOPTER_COM_LAYOUTS_H
+
+/**
+* Layouts of the reserved com channels (see com_master.h).
+* Each channel's buffer starts with the structure below, which its writer
+* fills and its readers read, in C with offsetof, in C++ through
+* jakopter_channels.hpp, in Lua with the same structures in jakopter_ffi.lua.
+* The Lua scripts that use cc_read_int/cc_read_float rely on the offsets,
+* so they're checked when compiling : moving a field breaks the build
+* instead of the scripts.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define COM_LAYOUT_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define COM_LAYOUT_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+/**
+* CHANNEL_NAVDATA, written by navdata.c from each demo packet.
+* Angles are in milli-degrees, speeds in mm/s.
+*/
+typedef struct jakopter_navdata_snapshot_t {
+	int32_t battery;
+	int32_t altitude;
+	float theta, phi, psi;
+	float vx, vy, vz;
+} jakopter_navdata_snapshot_t;
+
+/**
+* CHANNEL_DISPLAY, read by video_display.c.
+* Set screenshot to a non-zero value to save the current frame, it's reset once done.
+*/
+typedef struct jakopter_display_infos_t {
+	int32_t battery;
+	int32_t altitude;
+	float pitch, roll, yaw;
+	float speed;
+	int32_t screenshot;
+} jakopter_display_infos_t;
+
+/**
+* CHANNEL_USERINPUT, written by user_input.c.
+*/
+typedef struct jakopter_user_input_t {
+	int32_t key;
+	int32_t param;
+} jakopter_user_input_t;
+
+/**
+* Axes identified by actuation.c, in the order of jakopter_move's arguments.
+*/
+enum jakopter_actuation_axis {
+	ACTUATION_ROLL,
+	ACTUATION_PITCH,
+	ACTUATION_VERTICAL,
+	ACTUATION_YAW,
+	ACTUATION_NB_AXES
+};
+
+/**
+* Response of an axis.
+*/
+typedef struct jakopter_actuation_t {
+	//time before the response starts, in ms
+	float dead_time;
+	//time constant of the response, in ms
+	float tau;
+	//final change of the response per unit of setpoint
+	float gain;
+	//number of steps the estimation is based on, 0 if none yet
+	int32_t nb_steps;
+} jakopter_actuation_t;
+
+/**
+* CHANNEL_ACTUATION, written by actuation.c.
+*/
+typedef struct jakopter_actuation_channel_t {
+	jakopter_actuation_t axes[ACTUATION_NB_AXES];
+} jakopter_actuation_channel_t;
+
+
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, battery) == 0, "navdata : battery moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, altitude) == 4, "navdata : altitude moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, theta) == 8, "navdata : theta moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, phi) == 12, "navdata : phi moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, psi) == 16, "navdata : psi moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, vx) == 20, "navdata : vx moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, vy) == 24, "navdata : vy moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_navdata_snapshot_t, vz) == 28, "navdata : vz moved");
+COM_LAYOUT_ASSERT(sizeof(jakopter_navdata_snapshot_t) == 32, "navdata : unexpected size");
+
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, battery) == 0, "display : battery moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, altitude) == 4, "display : altitude moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, pitch) == 8, "display : pitch moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, roll) == 12, "display : roll moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, yaw) == 16, "display : yaw moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, speed) == 20, "display : speed moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_display_infos_t, screenshot) == 24, "display : screenshot moved");
+
+COM_LAYOUT_ASSERT(offsetof(jakopter_user_input_t, key) == 0, "user input : key moved");
+COM_LAYOUT_ASSERT(offsetof(jakopter_user_input_t, param) == 4, "user input : param moved");
+
+COM_LAYOUT_ASSERT(sizeof(jakopter_actuation_t) == 16, "actuation : unexpected entry size");
+
+#endif
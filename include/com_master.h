@@ -13,6 +13,7 @@ enum jakopter_channels {
 	CHANNEL_DISPLAY,
 	CHANNEL_LEAPMOTION,
 	CHANNEL_USERINPUT,
+	CHANNEL_ACTUATION,
 	NB_CHANNELS
 };
 
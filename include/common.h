@@ -0,0 +1,35 @@
+#ifndef JAKOPTER_COMMON_H
+#define JAKOPTER_COMMON_H
+
+// common.h is generated by CMake
+// See common.h.in if you need to modify the original
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* #undef WITH_VIDEO */
+/* #undef WITH_VIDEO_OFFLINE */
+/* #undef WITH_VIDEO_CLIP */
+#define WITH_JOYSTICK
+/* #undef WITH_LUA */
+
+#define float32_t float
+#define float64_t double
+
+#define WIFI_ARDRONE_IP	"192.168.1.1"
+/* Environment variable that overrides WIFI_ARDRONE_IP, e.g. to go through the netem proxy */
+#define DRONE_IP_ENV	"JAKOPTER_DRONE_IP"
+
+struct sockaddr_in addr_drone, addr_client;
+int sock_cmd;
+
+#endif
@@ -14,8 +14,10 @@
 #define NAVDATA_ATTEMPT  10
 #define HEIGHT_THRESHOLD 500
 
-/* Max number of digit into an integer */
-#define SIZE_INT		11
+/* Max number of characters of an integer, sign and '\0' included */
+#define SIZE_INT		12
+/* Size of a float argument, written as the integer that has the same bits */
+#define SIZE_FLOAT_ARG	SIZE_INT
 #define SIZE_TYPE		10
 #define SIZE_ARG		30
 #define ARGS_MAX 		7
@@ -42,7 +44,11 @@ int jakopter_backward(float speed);
 int jakopter_up(float speed);
 int jakopter_down(float speed);
 int jakopter_move(float l_to_r, float f_to_b, float vertical_speed, float angular_speed);
+int jakopter_set_move(float l_to_r, float f_to_b, float vertical_speed, float angular_speed);
 int jakopter_stay();
+int jakopter_config(const char* key, const char* value);
+void jakopter_input_stamp(double host_time);
+int jakopter_input_latency(double* last, double* mean, double* max);
 
 //DEBUG
 int jakopter_flat_trim();
@@ -50,6 +56,13 @@ int jakopter_calib();
 //Used by navdata
 int init_navdata_bootstrap();
 int init_navdata_ack();
+//Used by navdata and video
+const char* jakopter_drone_ip();
+int jakopter_reuse_port(int sock);
+//Used by the fleet sender
+int at_format(char* buf, size_t size, const char* cmd_type, int seq, char** args, int nb_args);
+void at_float_arg(char* buf, float value);
+extern char *takeoff_arg, *land_arg, *emergency_arg;
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef JAKOPTER_FLEET_H
+#define JAKOPTER_FLEET_H
+
+/**
+* Fleet sender : commands for several drones, sent on a single shared tick.
+* At each tick, the current command of every drone is encoded, and all of them
+* are handed to the kernel with one sendmmsg call, so that a maneuver given
+* to a group starts at the same time on every drone.
+* Each drone gets one datagram per tick, holding its REF and PCMD commands.
+* Drones are designated by their index in the list given to jakopter_fleet_connect,
+* and groups by a bit mask of these indices.
+*/
+
+#include "drone.h"
+
+#define FLEET_MAX_DRONES 32
+//mask designating every drone of the fleet
+#define FLEET_ALL 0xFFFFFFFFU
+//period of the shared tick, in ns
+#define FLEET_TICK TIMEOUT_CMD
+//number of ticks the emergency command is kept, before going back to landed (300 ms)
+#define FLEET_EMERGENCY_TICKS 10
+//number of ticks the landing command is sent on disconnection, before the tick stops (300 ms)
+#define FLEET_LANDING_TICKS 10
+
+/**
+* State requested from a drone with its REF command.
+*/
+enum jakopter_fleet_state {
+	FLEET_LANDED,
+	FLEET_FLYING,
+	FLEET_EMERGENCY
+};
+
+/**
+* Movement given to one drone, same as jakopter_move's arguments.
+*/
+typedef struct jakopter_fleet_setpoint_t {
+	int drone;
+	float l_to_r, f_to_b, vertical_speed, angular_speed;
+} jakopter_fleet_setpoint_t;
+
+/**
+* \brief Open the command socket and start the shared tick.
+*		Every drone starts landed and hovering.
+* \param ips addresses of the drones.
+* \param nb_drones number of drones, up to FLEET_MAX_DRONES.
+* \returns 0 on success, -1 on error.
+*/
+int jakopter_fleet_connect(const char** ips, int nb_drones);
+
+/**
+* \brief Stop the tick and close the socket. Drones still flying are asked to land first.
+* \returns 0 on success, -1 if the fleet wasn't connected.
+*/
+int jakopter_fleet_disconnect();
+
+/**
+* \brief Set the movement of several drones at once.
+*		All of them are applied together : they leave with the same tick.
+* \param setpoints one movement per drone, a drone can't appear twice.
+* \param nb number of setpoints.
+* \returns 0 on success, -1 if the fleet isn't connected or if a drone index is invalid
+*		(nothing is applied then).
+*/
+int jakopter_fleet_set_moves(const jakopter_fleet_setpoint_t* setpoints, int nb);
+
+/**
+* \brief Give the same movement to a group of drones, applied on the same tick.
+* \param group mask of the drones to move.
+* \returns 0 on success, -1 if the fleet isn't connected.
+*/
+int jakopter_fleet_group_move(uint32_t group, float l_to_r, float f_to_b, float vertical_speed, float angular_speed);
+
+/**
+* \brief Take off, land or cut the motors of a group of drones, on the same tick.
+*		Doesn't wait for the drones to react. Emergency is sent for FLEET_EMERGENCY_TICKS,
+*		then the drones are considered landed.
+* \param group mask of the drones.
+* \param state one of the jakopter_fleet_state values.
+* \returns 0 on success, -1 if the fleet isn't connected or the state is invalid.
+*/
+int jakopter_fleet_group_state(uint32_t group, int state);
+
+/**
+* \brief Skew of the last ticks : time spent handing the whole batch to the kernel,
+*		which bounds the time between the first and the last drone's datagram,
+*		plus how late the tick itself was on its schedule.
+* \param last, mean, max skew in microseconds, can be NULL.
+* \param late_max worst lateness of a tick, in microseconds, can be NULL.
+* \returns the number of ticks measured since the connection.
+*/
+int jakopter_fleet_skew(double* last, double* mean, double* max, double* late_max);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef JAKOPTER_CHANNELS_HPP
+#define JAKOPTER_CHANNELS_HPP
+
+/**
+* Typed access to the reserved com channels, for C++ programs (C++11).
+* Each channel id is bound to its layout from com_layouts.h at compile time,
+* so fields are accessed by name instead of by offset, and a program that
+* uses a field the layout doesn't have doesn't compile.
+* The channel's size is checked once, when it's looked up; after that,
+* accesses are plain loads and stores done under the channel's lock.
+*
+*	jakopter::channel<CHANNEL_NAVDATA> nav;
+*	if (nav) {
+*		jakopter_navdata_snapshot_t snapshot = nav.read();
+*		int32_t altitude = nav.get(&jakopter_navdata_snapshot_t::altitude);
+*	}
+*	jakopter::channel<CHANNEL_DISPLAY> display;
+*	display.write([&](jakopter_display_infos_t& infos) {
+*		infos.battery = snapshot.battery;
+*		infos.altitude = snapshot.altitude;
+*	});
+*/
+
+#include <cstddef>
+#include <type_traits>
+
+extern "C" {
+#include "com_channel.h"
+#include "com_master.h"
+#include "com_layouts.h"
+}
+
+namespace jakopter {
+
+/**
+* Layout of each channel. Channels without a specialization can't be used here.
+*/
+template<int Id> struct channel_layout;
+
+template<> struct channel_layout<CHANNEL_NAVDATA> { typedef jakopter_navdata_snapshot_t type; };
+template<> struct channel_layout<CHANNEL_DISPLAY> { typedef jakopter_display_infos_t type; };
+template<> struct channel_layout<CHANNEL_USERINPUT> { typedef jakopter_user_input_t type; };
+template<> struct channel_layout<CHANNEL_ACTUATION> { typedef jakopter_actuation_channel_t type; };
+
+/**
+* A reserved channel, seen through its layout.
+* It's looked up on construction : channels are destroyed when their module stops,
+* so don't keep one across a disconnection.
+*/
+template<int Id>
+class channel {
+public:
+	typedef typename channel_layout<Id>::type layout;
+
+	static_assert(Id > CHANNEL_MASTER && Id < NB_CHANNELS, "not a reserved channel");
+	static_assert(std::is_trivial<layout>::value && std::is_standard_layout<layout>::value,
+		"channel layouts are copied as raw bytes");
+
+	/**
+	* Held lock on the channel, giving direct access to its buffer.
+	* The channel is unlocked when it goes out of scope.
+	*/
+	class lock {
+	public:
+		explicit lock(jakopter_com_channel_t* cc, bool writing)
+			: cc(cc), writing(writing),
+			data(static_cast<layout*>(cc != NULL ? jakopter_com_lock(cc) : NULL)) {}
+		~lock() { if (data != NULL) jakopter_com_unlock(cc, writing); }
+		lock(lock&& other) : cc(other.cc), writing(other.writing), data(other.data) { other.data = NULL; }
+		lock(const lock&) = delete;
+		lock& operator=(const lock&) = delete;
+
+		explicit operator bool() const { return data != NULL; }
+		layout* operator->() const { return data; }
+		layout& operator*() const { return *data; }
+
+	private:
+		jakopter_com_channel_t* cc;
+		bool writing;
+		layout* data;
+	};
+
+	channel() : cc(jakopter_com_get_channel(Id))
+	{
+		//a channel too small for its layout would be read out of bounds
+		if (jakopter_com_get_size(cc) < sizeof(layout))
+			cc = NULL;
+	}
+
+	/**
+	* \returns whether the channel exists and can hold its layout.
+	*/
+	explicit operator bool() const { return cc != NULL; }
+
+	/**
+	* \brief Copy the whole layout at once.
+	* \returns the copy, zeroed if the channel doesn't exist.
+	*/
+	layout read() const
+	{
+		layout copy = layout();
+		lock held(cc, false);
+		if (held)
+			copy = *held;
+		return copy;
+	}
+
+	/**
+	* \brief Read one field.
+	* \param field pointer to the member, e.g. &jakopter_navdata_snapshot_t::altitude.
+	*/
+	template<typename T>
+	T get(T layout::*field) const
+	{
+		T value = T();
+		lock held(cc, false);
+		if (held)
+			value = (*held).*field;
+		return value;
+	}
+
+	/**
+	* \brief Write one field.
+	*/
+	template<typename T>
+	void set(T layout::*field, const T& value)
+	{
+		lock held(cc, true);
+		if (held)
+			(*held).*field = value;
+	}
+
+	/**
+	* \brief Modify several fields at once, f gets a layout&.
+	* \returns false if the channel doesn't exist.
+	*/
+	template<typename F>
+	bool write(F f)
+	{
+		lock held(cc, true);
+		if (!held)
+			return false;
+		f(*held);
+		return true;
+	}
+
+	/**
+	* \brief Lock the channel for direct access, see lock.
+	*/
+	lock access(bool writing) { return lock(cc, writing); }
+
+	/**
+	* \returns time of the last write in ms, see jakopter_com_get_timestamp.
+	*/
+	double timestamp() const { return cc != NULL ? jakopter_com_get_timestamp(cc) : 0; }
+
+private:
+	jakopter_com_channel_t* cc;
+};
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef JAKOPTER_JOYSTICK_H
+#define JAKOPTER_JOYSTICK_H
+
+/**
+* Joystick/gamepad control, through the Linux evdev interface.
+* Stick positions are turned into proportional setpoints, and written
+* into the command slot as soon as they change, so that they leave
+* with the next command tick.
+*/
+
+#include "common.h"
+
+//where input devices are looked for when no device is given
+#define JOYSTICK_DEV_DIR "/dev/input"
+#define JOYSTICK_MAX_DEVICES 8
+//default shaping of the stick values, see jakopter_joystick_set_curve
+#define JOYSTICK_DEADZONE 0.08
+#define JOYSTICK_EXPO 0.4
+
+/**
+* Axes of the drone's movement that are controlled by the sticks.
+*/
+enum joystick_axis {
+	JOY_ROLL,
+	JOY_PITCH,
+	JOY_THROTTLE,
+	JOY_YAW,
+	JOY_NB_AXES
+};
+
+/**
+* \brief Start reading the given input device, or every gamepad/joystick found.
+* \param device path of an evdev device (/dev/input/eventX, possibly created
+*		with uinput), or NULL to use all joysticks and gamepads in JOYSTICK_DEV_DIR.
+* \returns 0 on success, -1 if no device could be opened or the thread couldn't start.
+*/
+int jakopter_joystick_connect(const char* device);
+
+/**
+* \brief Stop reading the devices. The drone is left hovering.
+* \returns the pthread_join value, or -1 if the joystick wasn't connected.
+*/
+int jakopter_joystick_disconnect();
+
+/**
+* \brief Choose the evdev axis that controls an axis of the drone.
+*		The default mapping is mode 2 on a gamepad : left stick for throttle
+*		and yaw, right stick for roll and pitch.
+* \param axis one of the joystick_axis values.
+* \param code evdev code of the stick axis (ABS_X, ABS_RY...).
+* \param invert non-zero to reverse the direction of the stick.
+* \returns 0 on success, -1 if the axis or the code is invalid.
+*/
+int jakopter_joystick_map_axis(int axis, int code, int invert);
+
+/**
+* \brief Set the shaping applied to the stick values.
+* \param deadzone fraction of the stick's travel around its center that is ignored, in [0, 1[.
+* \param expo in [0, 1], 0 = linear response, 1 = cubic response (finer control around the center).
+*/
+void jakopter_joystick_set_curve(float deadzone, float expo);
+
+#endif
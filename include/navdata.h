@@ -4,9 +4,9 @@
 #include "common.h"
 #include "com_channel.h"
 #include "com_master.h"
+#include "com_layouts.h"
 
 #define PORT_NAVDATA	5554
-#define NAVDATA_INTERVAL 	1/15 // interval in seconds
 #define TAG_DEMO 0
 #define TAG_CKS 0
 
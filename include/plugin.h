@@ -0,0 +1,103 @@
+#ifndef JAKOPTER_PLUGIN_H
+#define JAKOPTER_PLUGIN_H
+
+/**
+* Optional modules loaded on demand.
+* The video, display and Lua parts drag in heavy libraries (libavcodec, SDL2, Lua),
+* so they're built as separate modules that the core library loads with dlopen
+* the first time they're needed. A program that only flies the drone
+* never loads them, and the core works even if they aren't installed.
+* Each module exports a single table of entry points, listed below;
+* the core's versions of these functions forward to it.
+*/
+
+#include "common.h"
+#include "video.h"
+#include "video_display.h"
+#include "video_offline.h"
+
+//bumped whenever one of the tables below changes
+#define JAKOPTER_PLUGIN_VERSION 3
+//environment variable giving the directory where the modules are, overrides the default
+#define PLUGIN_DIR_ENV "JAKOPTER_PLUGIN_DIR"
+//file name of a module, from its name
+#define PLUGIN_FILENAME_FORMAT "libjakopter_%s.so"
+
+//the only symbol a module exports, everything else is hidden
+#define JAKOPTER_PLUGIN_EXPORT __attribute__((visibility("default")))
+
+enum jakopter_plugin_id {
+	PLUGIN_VIDEO,
+	PLUGIN_DISPLAY,
+	PLUGIN_LUA,
+	NB_PLUGINS
+};
+
+/**
+* Video module : reception, decoding, offline processing and clip capture.
+* The entries of the features the module was built without are NULL.
+*/
+typedef struct jakopter_video_plugin_t {
+	int version;
+	int (*init_video)();
+	int (*stop_video)();
+	int (*set_camera)(int camera);
+	double (*get_switch_latency)();
+	int (*lock_frame)(jakopter_video_frame_t* view);
+	void (*unlock_frame)();
+	int (*get_quality)(jakopter_video_quality_t* quality);
+	int (*latency)(double* last, double* mean, double* max);
+	void (*quality_filter)(float min_sharpness, float max_clipped, float max_corruption);
+	int (*process_file)(const char* path, int nb_workers, video_offline_callback callback,
+		size_t result_size, void** results, void* user);
+	int (*clip)(double before, double after);
+	void (*clip_on_state)(uint32_t mask);
+	void (*clip_navdata_state)(uint32_t state);
+} jakopter_video_plugin_t;
+
+/**
+* Display module : video window and keyboard control.
+*/
+typedef struct jakopter_display_plugin_t {
+	int version;
+	int (*frame)(uint8_t* frame, int width, int height, int size);
+	int (*submit)(int stream, uint8_t* frame, int width, int height, int size);
+	int (*set_hud)(int stream, const video_display_hud_t* hud);
+	int (*remove_stream)(int stream);
+	int (*set_layout)(enum video_display_layout layout);
+	int (*init)();
+	void (*clean)();
+	void (*keyboard_enable)(int enabled);
+	void (*keyboard_set_ramp)(float max_speed, float accel);
+} jakopter_display_plugin_t;
+
+/**
+* Lua module : the classic bindings, opened by require("libjakopter").
+* The state is a lua_State*, the core doesn't know about Lua.
+*/
+typedef struct jakopter_lua_plugin_t {
+	int version;
+	int (*open)(void* L);
+} jakopter_lua_plugin_t;
+
+//names of the tables exported by the modules
+#define PLUGIN_VIDEO_SYMBOL "jakopter_video_plugin"
+#define PLUGIN_DISPLAY_SYMBOL "jakopter_display_plugin"
+#define PLUGIN_LUA_SYMBOL "jakopter_lua_plugin"
+
+/**
+* \brief Get the entry points of a module, loading it if it isn't yet.
+*		A module that failed to load isn't tried again.
+* \param id one of the jakopter_plugin_id values.
+* \returns the module's table, NULL if it isn't available.
+*/
+const void* jakopter_plugin_get(int id);
+
+/**
+* \brief Get the entry points of a module only if it's already loaded.
+*		Used by the core's hooks, which mustn't pull a module in by themselves.
+* \returns the module's table, NULL if it isn't loaded.
+*/
+const void* jakopter_plugin_peek(int id);
+
+#endif
@@ -4,6 +4,7 @@
 #include "common.h"
 #include "com_channel.h"
 #include "com_master.h"
+#include "com_layouts.h"
 
 #define USERINPUT_INTERVAL 	1/3 // interval in seconds
 
@@ -7,6 +7,48 @@
 #define VIDEO_TIMEOUT 4
 #define BASE_VIDEO_BUF_SIZE 1024
 #define PORT_VIDEO		5555
+/*After a camera switch, if no keyframe of the new camera's size has come
+in after this delay (ms), the next keyframe is accepted whatever its size.*/
+#define VIDEO_SWITCH_TIMEOUT 2000
+
+/**
+* Cameras of the drone, and the size of the video they produce.
+*/
+enum jakopter_camera {
+	JAKO_CAMERA_FRONT,
+	JAKO_CAMERA_BOTTOM,
+	JAKO_NB_CAMERAS
+};
+#define JAKO_CAMERA_FRONT_W 640
+#define JAKO_CAMERA_FRONT_H 360
+#define JAKO_CAMERA_BOTTOM_W 320
+#define JAKO_CAMERA_BOTTOM_H 240
+
+//number of bins of the luma histogram of jakopter_video_quality_t
+#define VIDEO_QUALITY_BINS 16
+
+/**
+* Quality metrics of a frame, computed on its luma at half resolution.
+* See video_quality.h.
+*/
+typedef struct jakopter_video_quality_t {
+	//set once the metrics below have been computed
+	int valid;
+	//variance of the Laplacian : low for blurred or featureless frames
+	float sharpness;
+	//mean luma, in [0, 255]
+	float brightness;
+	//fraction of the pixels in the first (black) and last (white) bins of the histogram
+	float underexposed, overexposed;
+	//fraction of the pixels in each luma bin
+	float histogram[VIDEO_QUALITY_BINS];
+	//in [0, 1] : how much the frame looks damaged by lost packets. 1 if the decoder failed since the last keyframe.
+	float corruption;
+	//set if the decoder failed on a frame this one may depend on
+	int decode_error;
+	//set if the frame passed the quality filter, see jakopter_video_quality_filter
+	int passed;
+} jakopter_video_quality_t;
 
 /**
 * Simple structure to hold a decoded video frame.
@@ -16,6 +58,9 @@ typedef struct jakopter_video_frame_t {
 	int w, h;
 	size_t size;
 	uint8_t* pixels;
+	jakopter_video_quality_t quality;
+	//host time at which the last bytes of the frame came in, from jakopter_clock_host_now. -1 if unknown.
+	double received;
 } jakopter_video_frame_t;
 
 /*
@@ -31,5 +76,61 @@ Ask the video thread to stop, but don't wait for it. Shouldn't be called by the
 */
 int video_set_stopped();
 
+/**
+* \brief Switch the video stream to the given camera.
+*		The decoder is flushed and its buffers are allocated for the new size;
+*		frames still coming from the previous camera are dropped
+*		until a keyframe of the new one comes in.
+* \param camera one of the jakopter_camera values.
+* \returns 0 on success, -1 if the camera is invalid or the command couldn't be sent.
+*/
+int jakopter_video_set_camera(int camera);
+
+/**
+* \brief Time between the last call to jakopter_video_set_camera
+*		and the first frame received from the new camera.
+* \returns the latency in milliseconds, -1 if no switch has completed yet.
+*/
+double jakopter_video_get_switch_latency();
+
+/**
+* \brief Get a read-only view of the last processed frame, without copying it.
+*		The view stays valid until jakopter_video_unlock_frame is called;
+*		meanwhile the video thread won't update it (it skips the update instead of waiting).
+*		Meant for FFI bindings, which can then read the pixels directly.
+* \param view structure that will point to the frame's pixels.
+* \returns the number of frames processed so far (> 0) on success,
+*		-1 if no frame is available yet or if this thread already holds the view.
+*		In that case, the view isn't locked.
+*/
+int jakopter_video_lock_frame(jakopter_video_frame_t* view);
+
+/**
+* \brief Release the view acquired with jakopter_video_lock_frame.
+*		Does nothing if this thread doesn't hold it.
+*/
+void jakopter_video_unlock_frame();
+
+/**
+* \brief Latency of the video frames, from the reception of their last bytes
+*		to the end of their processing (decoding, queue, quality check and display).
+*		The raw H.264 stream carries no capture time, so the time spent on the link
+*		isn't included : a degraded link shows up as frames coming late and irregularly.
+* \param last receives the latency of the last frame, in ms. Can be NULL.
+* \param mean receives the mean latency, in ms. Can be NULL.
+* \param max receives the highest latency, in ms. Can be NULL.
+* \returns the number of frames measured since the video started.
+*/
+int jakopter_video_latency(double* last, double* mean, double* max);
+
+/**
+* \brief Get the quality metrics of the last frame that went through the processing thread,
+*		whether it passed the quality filter or not.
+* \param quality where to copy the metrics, can be NULL.
+* \returns the number of frames dropped by the quality filter since the video started,
+*		-1 if no frame has been processed yet.
+*/
+int jakopter_video_get_quality(jakopter_video_quality_t* quality);
+
 #endif
 
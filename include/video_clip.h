@@ -0,0 +1,69 @@
+#ifndef JAKOPTER_VIDEO_CLIP_H
+#define JAKOPTER_VIDEO_CLIP_H
+
+/**
+* Clip capture : the compressed video stream is kept in a rolling
+* in-memory buffer, so that when something happens, the seconds that
+* preceded it can be saved along with the ones that follow.
+* The buffer always starts with a keyframe, and the oldest GOP is dropped
+* when it's full. Clips are written to MPEG-TS files by a background thread.
+*/
+
+#include "common.h"
+
+//maximum size of the compressed video kept in memory, in bytes
+#define CLIP_BUFFER_SIZE (16*1024*1024)
+//default length of a clip before and after the trigger, in seconds
+#define CLIP_DEFAULT_BEFORE 10
+#define CLIP_DEFAULT_AFTER 5
+//strftime format of the clip file names, based on the trigger time
+#define CLIP_FILENAME_FORMAT "clip_%Y%m%d_%H%M%S.ts"
+//navdata state bit raised on emergency, a sensible trigger for jakopter_video_clip_on_state
+#define CLIP_STATE_EMERGENCY (1U << 31)
+
+/**
+* \brief Start the clip writer thread and empty the buffer.
+*		Called when the video starts.
+* \returns 0 on success, -1 on error.
+*/
+int video_clip_init();
+
+/**
+* \brief Write the pending clip with what has been received so far, if any,
+*		then stop the writer thread and free the buffer.
+*/
+void video_clip_clean();
+
+/**
+* \brief Add a compressed frame, as produced by the frame parser, to the buffer.
+* \param data frame data, copied into the buffer.
+* \param size size of the frame in bytes.
+* \param key non-zero if it's a keyframe.
+*/
+void video_clip_push(const uint8_t* data, int size, int key);
+
+/**
+* \brief Check the navdata state for a rising edge of the bits set
+*		with jakopter_video_clip_on_state. Called for each navdata packet.
+*/
+void video_clip_navdata_state(uint32_t state);
+
+/**
+* \brief Save a clip around the current time, in the background.
+*		If a clip is already waiting for its end, that end is pushed back instead.
+*		If it's being written, a new clip is started, and written after it.
+*		The part before the trigger is limited by CLIP_BUFFER_SIZE.
+* \param before seconds of video to keep before now.
+* \param after seconds of video to keep after now.
+* \returns 0 on success, -1 if the video isn't running.
+*/
+int jakopter_video_clip(double before, double after);
+
+/**
+* \brief Save a clip, with the default lengths, whenever one of the given
+*		navdata state bits goes from 0 to 1.
+* \param mask bits of the drone's state to watch (e.g. CLIP_STATE_EMERGENCY), 0 to disable.
+*/
+void jakopter_video_clip_on_state(uint32_t mask);
+
+#endif
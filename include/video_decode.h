@@ -31,6 +31,17 @@ Returns:
 */
 int video_decode_packet(uint8_t* buffer, int buf_size, jakopter_video_frame_t* result);
 
+/*
+Drop the state of the parser and the decoder, and allocate the frame buffer
+for the given size (if > 0).
+Until a keyframe of this size is decoded, decoded frames are dropped.
+Must be called from the thread that decodes the packets.
+*/
+int video_decode_flush(int width, int height);
+
+/*Stop waiting for a keyframe of a given size : the next keyframe will be accepted.*/
+void video_decode_accept_any_keyframe();
+
 /*Free the decoder and its associated structures.*/
 void video_stop_decoder();
 
@@ -4,22 +4,99 @@
 #include <stdint.h>
 
 #define FONT_PATH "../../resources/FreeSans.ttf"
-//size of the input com channel for this module
+//size of the input com channel for this module, at least sizeof(jakopter_display_infos_t) (checked in video_display.c)
 #define DISPLAY_COM_IN_SIZE 32
+//maximum number of video streams that can be shown in the window at once
+#define DISPLAY_MAX_STREAMS 9
+//refresh rate assumed when SDL can't tell us the real one
+#define DISPLAY_DEFAULT_REFRESH 60
+
+/**
+* How the streams are arranged in the window.
+* GRID : every stream gets a cell of the same size.
+* PIP : stream 0 fills the window, the others are drawn as thumbnails over it.
+*/
+enum video_display_layout {
+	DISPLAY_LAYOUT_GRID,
+	DISPLAY_LAYOUT_PIP
+};
+
+/**
+* Flight informations drawn over a stream.
+* Angles are in degrees.
+*/
+typedef struct video_display_hud_t {
+	int bat, alt;
+	float pitch, roll, yaw;
+	float speed;
+} video_display_hud_t;
 
 /**
 * "Got frame" callback.
-* Fills the texture with the given frame, and displays it on the window.
+* Hands the given frame to the display as stream 0.
 */
 int video_display_frame(uint8_t* frame, int width, int height, int size);
 
 /**
-* Create the com_channel needed to communicate with the display module.
+* Hand a frame over to the display, as the given stream.
+* The frame is copied, it will be shown at the next screen refresh.
+* \returns 0 on success, -1 on error.
+*/
+int video_display_submit(int stream, uint8_t* frame, int width, int height, int size);
+
+/**
+* Set the flight informations drawn over the given stream.
+* Stream 0 is also kept updated from the display com channel.
+*/
+int video_display_set_hud(int stream, const video_display_hud_t* hud);
+
+/**
+* Stop showing the given stream and give its space back to the others.
+*/
+int video_display_remove_stream(int stream);
+
+/**
+* Choose how the streams are arranged in the window.
+*/
+int video_display_set_layout(enum video_display_layout layout);
+
+/**
+* \brief Show a frame in the video window, next to the drone's video.
+*		The window is the one opened by jakopter_init_video.
+* \param stream where to show it, from 0 to DISPLAY_MAX_STREAMS-1. Stream 0 is the drone's video.
+* \param frame YUV420p pixels, copied before returning.
+* \param size size of frame in bytes, at least width*height*3/2.
+* \returns 0 on success, -1 on error or if the video isn't running.
+*/
+int jakopter_display_submit(int stream, uint8_t* frame, int width, int height, int size);
+
+/**
+* \brief Set the flight informations drawn over a stream.
+* \returns 0 on success, -1 on error or if the video isn't running.
+*/
+int jakopter_display_set_hud(int stream, const video_display_hud_t* hud);
+
+/**
+* \brief Stop showing a stream, the others take its space.
+* \returns 0 on success, -1 on error or if the video isn't running.
+*/
+int jakopter_display_remove_stream(int stream);
+
+/**
+* \brief Choose how the streams are arranged in the window.
+* \param layout one of the video_display_layout values.
+* \returns 0 on success, -1 on error or if the video isn't running.
+*/
+int jakopter_display_set_layout(int layout);
+
+/**
+* Create the com_channel needed to communicate with the display module,
+* and start the render thread.
 */
 int video_display_init();
 
 /**
-* Free the memory associated with the module
+* Stop the render thread and free the memory associated with the module
 */
 void video_display_clean();
 
@@ -0,0 +1,58 @@
+#ifndef JAKOPTER_VIDEO_KEYBOARD_H
+#define JAKOPTER_VIDEO_KEYBOARD_H
+
+/**
+* Keyboard control from the video window.
+* Key events are handled by the display's render thread, and turned into
+* movement setpoints that ramp up while the keys are held. They are written
+* straight into the command slot, so they leave with the next command tick.
+* Keys are identified by their position (scancode), whatever the layout :
+*	arrows : forward/backward and left/right
+*	W/S : up/down, A/D : rotate left/right (Z/S and Q/D on AZERTY)
+*	space : take off, or land when flying
+*	escape : emergency
+*/
+
+//speed reached when a key is held, in [0, 1]
+#define KEYBOARD_MAX_SPEED 0.5
+//speed applied as soon as a key is pressed
+#define KEYBOARD_START_SPEED 0.1
+//how fast the speed ramps up while a key is held, and down once released (per second)
+#define KEYBOARD_ACCEL 1.0
+#define KEYBOARD_DECEL 4.0
+
+/**
+* \brief Handle a key press or release. Called by the render thread.
+* \param scancode SDL scancode of the key.
+* \param down 1 if the key has been pressed, 0 if released.
+* \param repeat non-zero for the automatic repetition of a held key.
+* \param time host time of the event, from jakopter_clock_host_now.
+*/
+void video_keyboard_key(int scancode, int down, int repeat, double time);
+
+/**
+* \brief Release every key, e.g. when the window loses the focus.
+*/
+void video_keyboard_release_all();
+
+/**
+* \brief Move the speeds along their ramps, and update the setpoint if needed.
+*		Called by the render thread at each iteration.
+* \returns 1 if the speeds are still changing, 0 otherwise.
+*/
+int video_keyboard_update();
+
+/**
+* \brief Enable or disable keyboard control from the video window.
+*		It's enabled by default. Disabling it makes the drone hover.
+*/
+void jakopter_keyboard_enable(int enabled);
+
+/**
+* \brief Change the speed reached by held keys, and how fast it's reached.
+* \param max_speed in ]0, 1].
+* \param accel ramp up rate, in speed per second. <= 0 to reach the speed at once.
+*/
+void jakopter_keyboard_set_ramp(float max_speed, float accel);
+
+#endif
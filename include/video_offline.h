@@ -0,0 +1,42 @@
+#ifndef JAKOPTER_VIDEO_OFFLINE_H
+#define JAKOPTER_VIDEO_OFFLINE_H
+
+/**
+* Offline video processing, for recorded streams.
+* Unlike the live pipeline, the whole file is available up front, so it is
+* split at keyframes and the resulting GOPs are decoded and processed
+* in parallel, each worker thread having its own decoder.
+*/
+
+#include "video.h"
+
+/**
+* Processing callback, run on every decoded frame of the file.
+* It may be called from several threads at once, and not in the file's order.
+* \param frame decoded frame, in YUV420p, with its quality metrics. Only valid during the call.
+*		Frames dropped by the quality filter or that couldn't be decoded don't get to the callback,
+*		their result stays zeroed.
+* \param index position of the frame in the file, from 0.
+* \param result where to store this frame's result (result_size bytes, zeroed beforehand).
+* \param user the pointer given to jakopter_video_process_file.
+* \returns LESS THAN 0 to abort the processing, anything else to go on.
+*/
+typedef int (*video_offline_callback)(const jakopter_video_frame_t* frame, int index, void* result, void* user);
+
+/**
+* \brief Decode and process a recorded video file (raw H.264 or any container
+*		libavformat can read) with a pool of worker threads.
+*		The compressed stream is kept in memory while it's processed.
+* \param path file to process.
+* \param nb_workers number of worker threads, <= 0 to use one per online CPU.
+* \param callback function run on every frame.
+* \param result_size size in bytes of the result of a single frame, can be 0.
+* \param results if not NULL and result_size > 0, receives an array holding the
+*		results of all frames, in the file's order. It must be freed by the caller.
+* \param user pointer passed as is to the callback.
+* \returns the number of frames in the file, -1 on error or if the processing was aborted.
+*/
+int jakopter_video_process_file(const char* path, int nb_workers, video_offline_callback callback,
+	size_t result_size, void** results, void* user);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef JAKOPTER_VIDEO_QUALITY_H
+#define JAKOPTER_VIDEO_QUALITY_H
+
+/**
+* Frame quality scoring, to drop unusable frames before they're recorded.
+* The metrics are computed on the luma plane averaged down to half resolution,
+* with plain loops over rows that the compiler vectorizes :
+*	sharpness : variance of the Laplacian, motion blur flattens it.
+*	exposure : luma histogram, and the part of the frame that is clipped to black or white.
+*	corruption : concealed macroblocks leave strong edges on the macroblock grid,
+*		so the gradients across the grid are compared to the ones inside the blocks.
+*		Frames decoded after a decoding error are marked as corrupted until the next keyframe.
+* The metrics are stored in the frame's quality field.
+*/
+
+#include "video.h"
+
+//size of a macroblock at half resolution
+#define VIDEO_QUALITY_BLOCK 8
+//ratio of the gradients across and inside the macroblocks that gives a corruption of 1
+#define VIDEO_QUALITY_BLOCKY_RATIO 3.0f
+//rows are processed in chunks of this many pixels, so that the row sums fit in 32 bits
+#define VIDEO_QUALITY_CHUNK 2048
+
+/**
+* \brief Compute the quality metrics of a frame, and store them in frame->quality.
+*		The decode_error field is kept as the decoder set it.
+*		Can be called from several threads, as long as they have their own scratch buffer.
+* \param frame YUV420p frame.
+* \param scratch buffer for the half resolution luma, (re)allocated as needed. Must be freed by the caller.
+* \param scratch_size allocated size of the scratch buffer.
+* \returns 0 on success, -1 on error (the metrics are then invalid).
+*/
+int video_quality_compute(jakopter_video_frame_t* frame, uint8_t** scratch, size_t* scratch_size);
+
+/**
+* \brief Check the metrics against the quality filter, and set their passed field.
+* \returns the value of the passed field.
+*/
+int video_quality_check(jakopter_video_quality_t* quality);
+
+/**
+* \brief Set the quality filter, which drops bad frames before they reach the processing
+*		callback (display or recorder) and the frame view. Offline processing skips them too,
+*		their result staying zeroed. Frames whose metrics couldn't be computed are kept.
+* \param min_sharpness frames with a lower sharpness are dropped, 0 to keep them all.
+* \param max_clipped frames with a larger fraction of black and white pixels are dropped, 1 to keep them all.
+* \param max_corruption frames with a higher corruption are dropped, 1 to keep them all.
+*/
+void jakopter_video_quality_filter(float min_sharpness, float max_clipped, float max_corruption);
+
+#endif
@@ -30,6 +30,11 @@ void video_queue_free();
 */
 void video_queue_push_frame(const jakopter_video_frame_t* frame);
 
+/**
+* \brief Drop the frame waiting in the queue, if any.
+*/
+void video_queue_flush();
+
 /**
 * \brief Get the frame at the head of the queue.
 *		The frame is removed from the queue, its pixel data is copied
@@ -0,0 +1,216 @@
+--[[
+FFI fast path for Jakopter, LuaJIT only.
+
+The classic bindings (require("libjakopter")) go through the Lua C API stack
+for every single value read from a com channel. This module declares the
+library's structures to the LuaJIT FFI instead, so that a whole channel
+payload is copied into a cdata structure with a single call, and its fields
+are then plain memory loads that the JIT can compile.
+
+Usage:
+	local l = require("libjakopter")
+	local jffi = require("jakopter_ffi")
+	local nav = jffi.navdata()
+	if jffi.read_navdata(nav) then print(nav.altitude) end
+
+Frames are exposed as views on the last processed frame, with their quality metrics.
+The view must only be used through with_frame, which releases it even if the
+function fails :
+	local ok, sharp = jffi.with_frame(function(frame, index)
+		local y = frame.pixels[0]
+		return frame.quality.sharpness
+	end)
+--]]
+
+local ffi = require("ffi")
+
+ffi.cdef[[
+typedef struct jakopter_com_channel_t jakopter_com_channel_t;
+
+jakopter_com_channel_t* jakopter_com_get_channel(int id);
+void jakopter_com_write_buf(jakopter_com_channel_t* cc, size_t offset, void* data, size_t size);
+void* jakopter_com_read_buf(jakopter_com_channel_t* cc, size_t offset, size_t size, void* dest);
+double jakopter_com_get_timestamp(jakopter_com_channel_t* cc);
+
+/* Layout of the navdata channel, see com_layouts.h */
+typedef struct jakopter_navdata_snapshot_t {
+	int32_t battery;
+	int32_t altitude;
+	float theta, phi, psi;
+	float vx, vy, vz;
+} jakopter_navdata_snapshot_t;
+
+/* Layout of the display channel, see com_layouts.h */
+typedef struct jakopter_display_infos_t {
+	int32_t battery;
+	int32_t altitude;
+	float pitch, roll, yaw;
+	float speed;
+	int32_t screenshot;
+} jakopter_display_infos_t;
+
+/* Layout of the user input channel, see com_layouts.h */
+typedef struct jakopter_user_input_t {
+	int32_t key;
+	int32_t param;
+} jakopter_user_input_t;
+
+/* Entry of the actuation channel, see com_layouts.h */
+typedef struct jakopter_actuation_t {
+	float dead_time;
+	float tau;
+	float gain;
+	int32_t nb_steps;
+} jakopter_actuation_t;
+
+/* Quality metrics of a frame, see video.h and video_quality.h */
+typedef struct jakopter_video_quality_t {
+	int valid;
+	float sharpness;
+	float brightness;
+	float underexposed, overexposed;
+	float histogram[16];
+	float corruption;
+	int decode_error;
+	int passed;
+} jakopter_video_quality_t;
+
+typedef struct jakopter_video_frame_t {
+	int w, h;
+	size_t size;
+	uint8_t* pixels;
+	jakopter_video_quality_t quality;
+	double received;
+} jakopter_video_frame_t;
+
+int jakopter_video_lock_frame(jakopter_video_frame_t* view);
+void jakopter_video_unlock_frame();
+int jakopter_display_submit(int stream, uint8_t* frame, int width, int height, int size);
+]]
+
+local M = {}
+
+--Channel ids, see the jakopter_channels enum in com_master.h
+M.CHANNEL_NAVDATA = 1
+M.CHANNEL_DISPLAY = 2
+M.CHANNEL_LEAPMOTION = 3
+M.CHANNEL_USERINPUT = 4
+M.CHANNEL_ACTUATION = 5
+
+--The library is already loaded by require("libjakopter"), but not with global
+--symbols, so look it up the same way require does and bind to it explicitly.
+local libpath = package.searchpath("libjakopter", package.cpath)
+local C = ffi.load(libpath or "jakopter")
+M.C = C
+
+--Constructors for the channel payloads.
+M.navdata = ffi.typeof("jakopter_navdata_snapshot_t")
+M.display_infos = ffi.typeof("jakopter_display_infos_t")
+M.user_input = ffi.typeof("jakopter_user_input_t")
+M.actuation = ffi.typeof("jakopter_actuation_t[4]")
+
+--Channels never move once created, so their pointers can be cached.
+local channels = {}
+local function get_channel(id)
+	local cc = channels[id]
+	if cc == nil or cc == ffi.NULL then
+		cc = C.jakopter_com_get_channel(id)
+		if cc == ffi.NULL then
+			return nil
+		end
+		channels[id] = cc
+	end
+	return cc
+end
+
+--Channels are destroyed on disconnection; call this after reconnecting.
+function M.reset()
+	channels = {}
+end
+
+--Copy the beginning of channel id into the given cdata structure.
+--Returns the structure, or nil if the channel doesn't exist.
+function M.read(id, dest)
+	local cc = get_channel(id)
+	if cc == nil or C.jakopter_com_read_buf(cc, 0, ffi.sizeof(dest), dest) == ffi.NULL then
+		return nil
+	end
+	return dest
+end
+
+--Copy the given cdata structure at the beginning of channel id.
+--If size is given, only its first size bytes are copied.
+function M.write(id, src, size)
+	local cc = get_channel(id)
+	if cc == nil then
+		return false
+	end
+	C.jakopter_com_write_buf(cc, 0, src, size or ffi.sizeof(src))
+	return true
+end
+
+function M.timestamp(id)
+	local cc = get_channel(id)
+	if cc == nil then
+		return 0
+	end
+	return C.jakopter_com_get_timestamp(cc)
+end
+
+function M.read_navdata(dest)
+	return M.read(M.CHANNEL_NAVDATA, dest) ~= nil
+end
+
+--Write the flight informations of a display_infos structure to the display channel,
+--leaving its screenshot field alone : another writer may have asked for one.
+function M.write_hud(src)
+	return M.write(M.CHANNEL_DISPLAY, src, ffi.offsetof("jakopter_display_infos_t", "screenshot"))
+end
+
+--Read the responses of the 4 axes, indexed from 0 in jakopter_move's order.
+function M.read_actuation(dest)
+	return M.read(M.CHANNEL_ACTUATION, dest) ~= nil
+end
+
+--Frame view, shared between calls to avoid allocating a cdata each time.
+local frame_view = ffi.new("jakopter_video_frame_t")
+
+--Lock the last processed frame and return a view on it, along with its index.
+--Returns nil if no frame is available, or if the library was built without video.
+--Low level : use with_frame, a Lua error between the two calls would keep the frame locked.
+function M.lock_frame()
+	local ok, index = pcall(C.jakopter_video_lock_frame, frame_view)
+	if not ok or index < 0 then
+		return nil
+	end
+	return frame_view, index
+end
+
+function M.unlock_frame()
+	C.jakopter_video_unlock_frame()
+end
+
+--Run fn(frame, index) with the last processed frame locked, and unlock it whatever happens.
+--The view is only valid during the call, don't keep it or its pixels pointer.
+--Returns true and fn's results, false if no frame is available.
+--Errors raised by fn are raised again once the frame is unlocked.
+function M.with_frame(fn)
+	local frame, index = M.lock_frame()
+	if frame == nil then
+		return false
+	end
+	local results = {pcall(fn, frame, index)}
+	M.unlock_frame()
+	if not results[1] then
+		error(results[2], 0)
+	end
+	return unpack(results)
+end
+
+--Show a frame (a locked view, or any jakopter_video_frame_t) in the video window as the given stream.
+--Unlike l.display_submit, the pixels aren't copied into a Lua string first.
+function M.display_submit(stream, frame)
+	return C.jakopter_display_submit(stream, frame.pixels, frame.w, frame.h, frame.size)
+end
+
+return M
@@ -0,0 +1,235 @@
+#include <math.h>
+#include "actuation.h"
+#include "com_master.h"
+
+//first-order response : 10% of the change is reached ln(1/0.9) time constants after the dead time
+#define RESPONSE_T10 0.10536f
+#define RESPONSE_T63 1.0f
+
+struct actuation_axis {
+	//last setpoint sent
+	float setpoint;
+	//step being watched
+	int active;
+	double start;
+	float step;
+	//response when the step was sent
+	float baseline;
+	int nb_samples;
+	double times[ACTUATION_MAX_SAMPLES];
+	float values[ACTUATION_MAX_SAMPLES];
+	//last identified steps, circular
+	jakopter_actuation_t window[ACTUATION_WINDOW];
+	int window_count, window_next;
+	//medians of the window
+	jakopter_actuation_t estimation;
+};
+
+static struct actuation_axis axes[ACTUATION_NB_AXES];
+//smallest response change that isn't taken for noise : degrees, degrees, mm/s, degrees/s
+static const float min_response[ACTUATION_NB_AXES] = {1, 1, 50, 5};
+
+//current response of each axis, from the last navdata
+static float response[ACTUATION_NB_AXES];
+static int response_valid = 0;
+//previous navdata, for the rates
+static double prev_time = -1;
+static float prev_psi = 0;
+static int prev_altitude = 0;
+
+static jakopter_com_channel_t* actuation_channel = NULL;
+static pthread_mutex_t mutex_actuation = PTHREAD_MUTEX_INITIALIZER;
+
+
+static int compare_float(const void* a, const void* b)
+{
+	float fa = *(const float*)a, fb = *(const float*)b;
+	return (fa > fb) - (fa < fb);
+}
+
+static float median(float* values, int nb)
+{
+	qsort(values, nb, sizeof(float), compare_float);
+	return nb % 2 ? values[nb/2] : (values[nb/2 - 1] + values[nb/2]) / 2;
+}
+
+/**
+* Update the medians of an axis, and publish them.
+*/
+static void actuation_publish(int index)
+{
+	struct actuation_axis* axis = &axes[index];
+	float dead_times[ACTUATION_WINDOW], taus[ACTUATION_WINDOW], gains[ACTUATION_WINDOW];
+	int i = 0;
+	for (i = 0; i < axis->window_count; i++) {
+		dead_times[i] = axis->window[i].dead_time;
+		taus[i] = axis->window[i].tau;
+		gains[i] = axis->window[i].gain;
+	}
+	axis->estimation.dead_time = median(dead_times, axis->window_count);
+	axis->estimation.tau = median(taus, axis->window_count);
+	axis->estimation.gain = median(gains, axis->window_count);
+	axis->estimation.nb_steps = axis->window_count;
+
+	if (actuation_channel != NULL)
+		jakopter_com_write_buf(actuation_channel,
+			offsetof(jakopter_actuation_channel_t, axes) + index*sizeof(jakopter_actuation_t),
+			&axis->estimation, sizeof(jakopter_actuation_t));
+}
+
+/**
+* Time at which the response reaches the given fraction of its change,
+* interpolated between the samples around it.
+* \returns the time, -1 if it's never reached.
+*/
+static double actuation_crossing(const struct actuation_axis* axis, float change, float fraction)
+{
+	double prev_t = axis->start;
+	float prev_p = 0;
+	int i = 0;
+	for (i = 0; i < axis->nb_samples; i++) {
+		float p = (axis->values[i] - axis->baseline) / change;
+		if (p >= fraction) {
+			if (p == prev_p)
+				return axis->times[i];
+			return prev_t + (fraction - prev_p) / (p - prev_p) * (axis->times[i] - prev_t);
+		}
+		prev_t = axis->times[i];
+		prev_p = p;
+	}
+	return -1;
+}
+
+/**
+* End the watch of a step, and add its parameters to the window if the response is clear enough.
+*/
+static void actuation_fit(int index, double end)
+{
+	struct actuation_axis* axis = &axes[index];
+	axis->active = 0;
+	if (end - axis->start < ACTUATION_MIN_EPISODE || axis->nb_samples < 4)
+		return;
+
+	//final value : mean of the last third of the watch
+	double tail = axis->start + (end - axis->start) * 2 / 3;
+	float final = 0;
+	int i = 0, nb_tail = 0;
+	for (i = 0; i < axis->nb_samples; i++)
+		if (axis->times[i] >= tail) {
+			final += axis->values[i];
+			nb_tail++;
+		}
+	if (nb_tail == 0)
+		return;
+	float change = final / nb_tail - axis->baseline;
+	if (fabsf(change) < min_response[index])
+		return;
+
+	double t10 = actuation_crossing(axis, change, 0.1f);
+	double t63 = actuation_crossing(axis, change, 0.632f);
+	if (t10 < 0 || t63 <= t10)
+		return;
+	jakopter_actuation_t step;
+	step.tau = (t63 - t10) / (RESPONSE_T63 - RESPONSE_T10);
+	step.dead_time = t10 - axis->start - RESPONSE_T10 * step.tau;
+	if (step.dead_time < 0)
+		step.dead_time = 0;
+	step.gain = change / axis->step;
+	step.nb_steps = 1;
+
+	axis->window[axis->window_next] = step;
+	axis->window_next = (axis->window_next + 1) % ACTUATION_WINDOW;
+	if (axis->window_count < ACTUATION_WINDOW)
+		axis->window_count++;
+	actuation_publish(index);
+}
+
+void actuation_add_command(double host_time, const float setpoint[ACTUATION_NB_AXES])
+{
+	int i = 0;
+	pthread_mutex_lock(&mutex_actuation);
+	for (i = 0; i < ACTUATION_NB_AXES; i++) {
+		float diff = setpoint[i] - axes[i].setpoint;
+		if (diff == 0)
+			continue;
+		//any change disturbs the response being watched
+		if (axes[i].active)
+			actuation_fit(i, host_time);
+		if (fabsf(diff) >= ACTUATION_MIN_STEP && response_valid) {
+			axes[i].active = 1;
+			axes[i].start = host_time;
+			axes[i].step = diff;
+			axes[i].baseline = response[i];
+			axes[i].nb_samples = 0;
+		}
+		axes[i].setpoint = setpoint[i];
+	}
+	pthread_mutex_unlock(&mutex_actuation);
+}
+
+void actuation_add_navdata(double host_time, float theta, float phi, float psi, int altitude)
+{
+	int i = 0;
+	pthread_mutex_lock(&mutex_actuation);
+	double dt = (host_time - prev_time) / 1000;
+	if (prev_time >= 0 && dt > 0) {
+		float dpsi = psi - prev_psi;
+		//yaw wraps around at +/-180 degrees
+		if (dpsi > 180000)
+			dpsi -= 360000;
+		else if (dpsi < -180000)
+			dpsi += 360000;
+		response[ACTUATION_ROLL] = phi / 1000;
+		response[ACTUATION_PITCH] = theta / 1000;
+		response[ACTUATION_VERTICAL] = (altitude - prev_altitude) / dt;
+		response[ACTUATION_YAW] = dpsi / 1000 / dt;
+		response_valid = 1;
+
+		for (i = 0; i < ACTUATION_NB_AXES; i++) {
+			struct actuation_axis* axis = &axes[i];
+			if (!axis->active)
+				continue;
+			if (host_time - axis->start > ACTUATION_EPISODE || axis->nb_samples == ACTUATION_MAX_SAMPLES)
+				actuation_fit(i, host_time);
+			else {
+				axis->times[axis->nb_samples] = host_time;
+				axis->values[axis->nb_samples] = response[i];
+				axis->nb_samples++;
+			}
+		}
+	}
+	prev_time = host_time;
+	prev_psi = psi;
+	prev_altitude = altitude;
+	pthread_mutex_unlock(&mutex_actuation);
+}
+
+int jakopter_actuation_get(int axis, jakopter_actuation_t* estimation)
+{
+	if (axis < 0 || axis >= ACTUATION_NB_AXES)
+		return -1;
+	pthread_mutex_lock(&mutex_actuation);
+	*estimation = axes[axis].estimation;
+	pthread_mutex_unlock(&mutex_actuation);
+	return estimation->nb_steps;
+}
+
+void actuation_init()
+{
+	pthread_mutex_lock(&mutex_actuation);
+	memset(axes, 0, sizeof(axes));
+	memset(response, 0, sizeof(response));
+	response_valid = 0;
+	prev_time = -1;
+	actuation_channel = jakopter_com_add_channel(CHANNEL_ACTUATION, ACTUATION_COM_SIZE);
+	pthread_mutex_unlock(&mutex_actuation);
+}
+
+void actuation_clean()
+{
+	pthread_mutex_lock(&mutex_actuation);
+	if (actuation_channel != NULL)
+		jakopter_com_remove_channel(CHANNEL_ACTUATION);
+	actuation_channel = NULL;
+	pthread_mutex_unlock(&mutex_actuation);
+}
@@ -0,0 +1,175 @@
+#include <math.h>
+#include <time.h>
+#include "clock_sync.h"
+
+/**
+* Fastest sample of a filtering window.
+*/
+typedef struct sync_window {
+	//drone time of the sample
+	double drone;
+	//host time - drone time, made of the clock offset plus the network delay
+	double delay;
+} sync_window_t;
+
+//past windows, in a circular buffer
+static sync_window_t windows[CLOCK_SYNC_NB_WINDOWS];
+static int nb_windows = 0;
+static int next_window = 0;
+//window being filled, start is its first drone time
+static sync_window_t current;
+static double current_start = 0;
+static bool current_empty = true;
+//drone time of the newest sample, to drop stale ones and detect a reset of the drone's clock
+static double last_drone = -1;
+
+//result of the last fit
+static bool sync_valid = false;
+static double sync_reference = 0;
+static double sync_offset = 0;
+static double sync_drift = 0;
+static double sync_bound = 0;
+
+static pthread_mutex_t mutex_sync = PTHREAD_MUTEX_INITIALIZER;
+
+double jakopter_clock_host_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000.0 + now.tv_nsec/1000000.0;
+}
+
+static void reset_state()
+{
+	nb_windows = 0;
+	next_window = 0;
+	current_empty = true;
+	last_drone = -1;
+	sync_valid = false;
+}
+
+/**
+* Least squares fit of the window minimums : delay = a + b * (drone - reference).
+*/
+static void fit_windows()
+{
+	int i=0;
+	double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+	//the most recent window is the reference, so that the offset is up to date
+	double reference = windows[(next_window + CLOCK_SYNC_NB_WINDOWS - 1) % CLOCK_SYNC_NB_WINDOWS].drone;
+
+	if(nb_windows < CLOCK_SYNC_MIN_WINDOWS)
+		return;
+
+	for(i=0 ; i<nb_windows ; i++) {
+		double x = windows[i].drone - reference;
+		sum_x += x;
+		sum_y += windows[i].delay;
+		sum_xx += x*x;
+		sum_xy += x*windows[i].delay;
+	}
+	double det = nb_windows*sum_xx - sum_x*sum_x;
+	if(det <= 0)
+		return;
+	double b = (nb_windows*sum_xy - sum_x*sum_y) / det;
+	double a = (sum_y - b*sum_x) / nb_windows;
+
+	//the spread of the minimums around the line is what the filter couldn't remove
+	double residual = 0;
+	for(i=0 ; i<nb_windows ; i++) {
+		double r = fabs(windows[i].delay - (a + b*(windows[i].drone - reference)));
+		if(r > residual)
+			residual = r;
+	}
+
+	/*The drone's packets carry no echo of ours, so the one-way delay can't be
+	split from the offset : the offset keeps the delay of the fastest packets,
+	and the bound only covers what the filter left around the line.*/
+	sync_reference = reference;
+	sync_drift = b;
+	sync_offset = a;
+	sync_bound = residual;
+	sync_valid = true;
+}
+
+void clock_sync_add_sample(double drone_time, double host_time)
+{
+	pthread_mutex_lock(&mutex_sync);
+	if(last_drone >= 0 && drone_time <= last_drone) {
+		//reordered or duplicated packet : its timing says nothing new
+		if(last_drone - drone_time <= CLOCK_SYNC_RESET_JUMP) {
+			pthread_mutex_unlock(&mutex_sync);
+			return;
+		}
+		fprintf(stderr, "[~][clock_sync] drone clock went back, restarting the estimation\n");
+		reset_state();
+	}
+	last_drone = drone_time;
+
+	//close the current window and fit the line again
+	if(!current_empty && drone_time >= current_start + CLOCK_SYNC_WINDOW) {
+		windows[next_window] = current;
+		next_window = (next_window+1) % CLOCK_SYNC_NB_WINDOWS;
+		if(nb_windows < CLOCK_SYNC_NB_WINDOWS)
+			nb_windows++;
+		current_empty = true;
+		fit_windows();
+	}
+
+	double delay = host_time - drone_time;
+	if(current_empty) {
+		current_start = drone_time;
+		current.drone = drone_time;
+		current.delay = delay;
+		current_empty = false;
+	}
+	else if(delay < current.delay) {
+		current.drone = drone_time;
+		current.delay = delay;
+	}
+	pthread_mutex_unlock(&mutex_sync);
+}
+
+void clock_sync_reset()
+{
+	pthread_mutex_lock(&mutex_sync);
+	reset_state();
+	pthread_mutex_unlock(&mutex_sync);
+}
+
+int jakopter_clock_get_sync(double* offset, double* drift, double* bound)
+{
+	pthread_mutex_lock(&mutex_sync);
+	if(!sync_valid) {
+		pthread_mutex_unlock(&mutex_sync);
+		return -1;
+	}
+	if(offset != NULL)
+		*offset = sync_offset;
+	if(drift != NULL)
+		*drift = sync_drift;
+	if(bound != NULL)
+		*bound = sync_bound;
+	pthread_mutex_unlock(&mutex_sync);
+	return 0;
+}
+
+double jakopter_clock_drone_to_host(double drone_time)
+{
+	double host_time = -1;
+	pthread_mutex_lock(&mutex_sync);
+	if(sync_valid)
+		host_time = drone_time + sync_offset + sync_drift*(drone_time - sync_reference);
+	pthread_mutex_unlock(&mutex_sync);
+	return host_time;
+}
+
+double jakopter_clock_host_to_drone(double host_time)
+{
+	double drone_time = -1;
+	pthread_mutex_lock(&mutex_sync);
+	if(sync_valid)
+		drone_time = (host_time - sync_offset + sync_drift*sync_reference) / (1 + sync_drift);
+	pthread_mutex_unlock(&mutex_sync);
+	return drone_time;
+}
@@ -251,6 +251,32 @@ void* jakopter_com_read_buf(jakopter_com_channel_t* cc, size_t offset, size_t si
 	return dest;
 }
 
+void* jakopter_com_lock(jakopter_com_channel_t* cc)
+{
+	//debug checks
+	if(cc == NULL) {
+		fprintf(stderr, "[com_channel] Error : got NULL com channel\n");
+		return NULL;
+	}
+	pthread_mutex_lock(&cc->mutex);
+	return cc->buffer;
+}
+
+void jakopter_com_unlock(jakopter_com_channel_t* cc, int written)
+{
+	if(cc == NULL)
+		return;
+	if(written)
+		cc->last_write_time = clock();
+	pthread_mutex_unlock(&cc->mutex);
+}
+
+size_t jakopter_com_get_size(jakopter_com_channel_t* cc)
+{
+	//the size never changes, no need to lock
+	return cc != NULL ? cc->buf_size : 0;
+}
+
 
 double jakopter_com_get_timestamp(jakopter_com_channel_t* cc)
 {
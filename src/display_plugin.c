@@ -0,0 +1,18 @@
+#include "plugin.h"
+#include "video_keyboard.h"
+
+/*
+Table of the display module, looked up by the core when the video starts.
+*/
+JAKOPTER_PLUGIN_EXPORT const jakopter_display_plugin_t jakopter_display_plugin = {
+	.version = JAKOPTER_PLUGIN_VERSION,
+	.frame = video_display_frame,
+	.submit = video_display_submit,
+	.set_hud = video_display_set_hud,
+	.remove_stream = video_display_remove_stream,
+	.set_layout = video_display_set_layout,
+	.init = video_display_init,
+	.clean = video_display_clean,
+	.keyboard_enable = jakopter_keyboard_enable,
+	.keyboard_set_ramp = jakopter_keyboard_set_ramp,
+};
@@ -2,6 +2,8 @@
 #include "drone.h"
 #include "navdata.h"
 #include "user_input.h"
+#include "clock_sync.h"
+#include "actuation.h"
 
 /* The string sent to the drone.*/
 char command[PACKET_SIZE];
@@ -15,6 +17,14 @@ int cmd_no_sq = 0;
 /* Command currently sent.*/
 char *command_type = NULL;
 char command_args[ARGS_MAX][SIZE_ARG];
+/* Speeds of the current command, all 0 unless it's a moving PCMD.*/
+static float command_setpoint[4];
+
+/* Host time of the user input that led to the current command, < 0 once sent.*/
+static double input_time = -1;
+/* Input to wire latency statistics, in ms.*/
+static double input_latency_last = -1, input_latency_sum = 0, input_latency_max = 0;
+static int input_latency_count = 0;
 
 /* Waiting time spend by command function */
 struct timespec cmd_wait = {0, NAVDATA_ATTEMPT*TIMEOUT_CMD};
@@ -29,19 +39,21 @@ static pthread_mutex_t mutex_cmd = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mutex_stopped = PTHREAD_MUTEX_INITIALIZER;
 
 /**
- * \brief Change the current command sent.
- * \param cmd_type header as AT*SOMETHING
- * \param args arguments of the command
- * \param nb_args number of arguments
+ * \brief Change the current command sent, along with the speeds it asks for.
+ * \param setpoint the 4 speeds of a PCMD, NULL for any other command or to hover
  * \returns -1 if nb_args greater than the max number of arguments
 */
-int set_cmd(char* cmd_type, char** args, int nb_args)
+static int set_cmd_setpoint(char* cmd_type, char** args, int nb_args, const float* setpoint)
 {
 	if (nb_args > ARGS_MAX)
 		return -1;
 
 	pthread_mutex_lock(&mutex_cmd);
 	command_type = cmd_type;
+	if (setpoint != NULL)
+		memcpy(command_setpoint, setpoint, sizeof(command_setpoint));
+	else
+		memset(command_setpoint, 0, sizeof(command_setpoint));
 
 	int i = 0;
 	for (i = 0; i < nb_args; i++) {
@@ -55,6 +67,54 @@ int set_cmd(char* cmd_type, char** args, int nb_args)
 	return 0;
 }
 
+/**
+ * \brief Change the current command sent.
+ * \param cmd_type header as AT*SOMETHING
+ * \param args arguments of the command
+ * \param nb_args number of arguments
+ * \returns -1 if nb_args greater than the max number of arguments
+*/
+int set_cmd(char* cmd_type, char** args, int nb_args)
+{
+	return set_cmd_setpoint(cmd_type, args, nb_args, NULL);
+}
+
+
+/**
+ * \brief Write an AT command, as "AT*TYPE=seq,arg1,...,argN\r".
+ * \param buf where to write the command, with its terminating '\0'
+ * \param size size of buf
+ * \param cmd_type header as SOMETHING, for AT*SOMETHING
+ * \param seq sequence number of the command
+ * \param args arguments of the command, can be NULL if nb_args is 0
+ * \param nb_args number of arguments
+ * \returns the length of the command, -1 if it doesn't fit in buf
+*/
+int at_format(char* buf, size_t size, const char* cmd_type, int seq, char** args, int nb_args)
+{
+	int len = snprintf(buf, size, "AT*%s=%d", cmd_type, seq);
+
+	int i = 0;
+	for (i = 0; i < nb_args && len >= 0 && len < size; i++)
+		len += snprintf(buf + len, size - len, ",%s", args[i]);
+
+	if (len >= 0 && len < size)
+		len += snprintf(buf + len, size - len, "\r");
+
+	return (len >= 0 && len < size) ? len : -1;
+}
+
+/**
+ * \brief Write a float argument the way the drone expects it :
+ * the integer that has the same bits.
+ * \param buf destination, of SIZE_FLOAT_ARG bytes
+*/
+void at_float_arg(char* buf, float value)
+{
+	int32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	snprintf(buf, SIZE_FLOAT_ARG, "%d", bits);
+}
 
 /**
  * \brief Send the current command stored in command_type.
@@ -67,30 +127,31 @@ int send_cmd()
 
 	if (command_type != NULL) {
 		memset(command, 0, PACKET_SIZE);
-		command[0] = '\0';
-
-		char buf[SIZE_INT];
-		snprintf(buf, SIZE_INT, "%d", cmd_no_sq);
 
-		strncat(command, "AT*", 4);
-		strncat(command, command_type, SIZE_TYPE);
-		strncat(command, "=", 2);
-		strncat(command, buf, SIZE_INT);
-
-		int i = 0;
-
-		while((i < ARGS_MAX) && (command_args[i][0] != '\0')) {
-			strncat(command, ",", 2);
-			strncat(command, command_args[i], SIZE_ARG);
-			i++;
+		char* args[ARGS_MAX];
+		int nb_args = 0;
+		while ((nb_args < ARGS_MAX) && (command_args[nb_args][0] != '\0')) {
+			args[nb_args] = command_args[nb_args];
+			nb_args++;
 		}
 
-		strncat(command, "\r", 2);
+		at_format(command, PACKET_SIZE, command_type, cmd_no_sq, args, nb_args);
 
 		cmd_no_sq++;
 
 		ret = sendto(sock_cmd, command, PACKET_SIZE, 0, (struct sockaddr*)&addr_drone, sizeof(addr_drone));
 
+		if (input_time >= 0 && ret >= 0) {
+			input_latency_last = jakopter_clock_host_now() - input_time;
+			input_latency_sum += input_latency_last;
+			if (input_latency_last > input_latency_max)
+				input_latency_max = input_latency_last;
+			input_latency_count++;
+			input_time = -1;
+		}
+		if (ret >= 0 && strcmp(command_type, HEAD_PCMD) == 0)
+			actuation_add_command(jakopter_clock_host_now(), command_setpoint);
+
 		pthread_mutex_unlock(&mutex_cmd);
 
 		return ret;
@@ -168,6 +229,32 @@ void* cmd_routine(void* args)
 	pthread_exit(NULL);
 }
 
+/**
+ * \brief Address of the drone : WIFI_ARDRONE_IP, unless DRONE_IP_ENV is set.
+ * \returns the address as a string.
+*/
+const char* jakopter_drone_ip()
+{
+	const char* ip = getenv(DRONE_IP_ENV);
+	return (ip != NULL && ip[0] != '\0') ? ip : WIFI_ARDRONE_IP;
+}
+
+/**
+ * \brief Allow the socket to share its port with sockets bound to other local addresses,
+ * like a proxy or a drone stand-in running on the same host.
+ * Only done when DRONE_IP_ENV is set : with the real drone, a second process
+ * bound to the same port would silently get part of the packets.
+ * \returns setsockopt return code, 0 if the port isn't shared.
+*/
+int jakopter_reuse_port(int sock)
+{
+	const char* ip = getenv(DRONE_IP_ENV);
+	if (ip == NULL || ip[0] == '\0')
+		return 0;
+	int yes = 1;
+	return setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+}
+
 /**
  * \brief Creates a socket and starts the command thread. Needs the computer to be connected to the drone wifi network.
  * \returns 0 if success, -1 if error
@@ -183,7 +270,7 @@ int jakopter_connect()
 	pthread_mutex_unlock(&mutex_stopped);
 
 	addr_drone.sin_family      = AF_INET;
-	addr_drone.sin_addr.s_addr = inet_addr(WIFI_ARDRONE_IP);
+	addr_drone.sin_addr.s_addr = inet_addr(jakopter_drone_ip());
 	addr_drone.sin_port        = htons(PORT_CMD);
 
 	addr_client.sin_family      = AF_INET;
@@ -195,6 +282,7 @@ int jakopter_connect()
 		fprintf(stderr, "[~] Can't establish socket \n");
 		return -1;
 	}
+	jakopter_reuse_port(sock_cmd);
 
 	if (bind(sock_cmd, (struct sockaddr*)&addr_client, sizeof(addr_client)) < 0) {
 		fprintf(stderr, "[~] Can't bind socket to port %d\n", PORT_CMD);
@@ -376,6 +464,30 @@ int jakopter_emergency()
 	return 0;
 }
 
+/**
+  * \brief Change a configuration key of the drone.
+  * \param key name of the key, as "category:name"
+  * \param value new value of the key
+  * \returns 0 if success, -1 if command couldn't be set.
+  */
+int jakopter_config(const char* key, const char* value)
+{
+	char quoted_key[SIZE_ARG], quoted_value[SIZE_ARG];
+	snprintf(quoted_key, SIZE_ARG, "\"%s\"", key);
+	snprintf(quoted_value, SIZE_ARG, "\"%s\"", value);
+
+	char * args[] = {quoted_key, quoted_value};
+	if (set_cmd(HEAD_CONFIG, args, 2) < 0)
+		return -1;
+
+	nanosleep(&cmd_wait, NULL);
+
+	if (set_cmd(NULL, NULL, 0) < 0)
+		return -1;
+
+	return 0;
+}
+
 /**
   * \brief Command to make the drone stay at its position.
   * \returns 0 if success, -1 if command couldn't be set.
@@ -497,6 +609,28 @@ int jakopter_reinit()
 
 	return 0;
 }
+/**
+  * \brief Encode and set a PCMD command, without waiting.
+  * \param flag "1" to enable progressive commands, "0" to hover
+  * \returns 0 if success, -1 if command couldn't be set.
+  */
+static int set_pcmd(char* flag, float l_to_r, float f_to_b, float vertical_speed, float angular_speed)
+{
+	float speeds[4] = {l_to_r, f_to_b, vertical_speed, angular_speed};
+	char bufs[4][SIZE_FLOAT_ARG];
+	char * args[5];
+	args[0] = flag;
+
+	int i = 0;
+	for (i = 0; i < 4; i++) {
+		at_float_arg(bufs[i], speeds[i]);
+		args[i+1] = bufs[i];
+	}
+
+	//hovering ignores the speeds
+	return set_cmd_setpoint(HEAD_PCMD, args, 5, strcmp(flag, "0") ? speeds : NULL);
+}
+
 /**
   * \brief define the movement of the drone
   * \param l_to_r the speed from left to right
@@ -507,26 +641,7 @@ int jakopter_reinit()
   */
 int jakopter_move(float l_to_r, float f_to_b, float vertical_speed, float angular_speed)
 {
-	char * args[5];
-	args[0] = "1";
-
-	char buf[SIZE_INT];
-	snprintf(buf, SIZE_INT, "%d", *((int *) &l_to_r));
-	args[1] = buf;
-
-	char buf2[SIZE_INT];
-	snprintf(buf2, SIZE_INT, "%d", *((int *) &f_to_b));
-	args[2] = buf2;
-
-	char buf3[SIZE_INT];
-	snprintf(buf3, SIZE_INT, "%d", *((int *) &vertical_speed));
-	args[3] = buf3;
-
-	char buf4[SIZE_INT];
-	snprintf(buf4, SIZE_INT, "%d", *((int *) &angular_speed));
-	args[4] = buf4;
-
-	if (set_cmd(HEAD_PCMD, args, 5) < 0)
+	if (set_pcmd("1", l_to_r, f_to_b, vertical_speed, angular_speed) < 0)
 		return -1;
 
 	nanosleep(&cmd_wait, NULL);
@@ -534,6 +649,57 @@ int jakopter_move(float l_to_r, float f_to_b, float vertical_speed, float angula
 	return 0;
 }
 
+/**
+  * \brief Set the movement of the drone without waiting, for continuous control (joystick...).
+  *		The command is sent at the next command tick, and repeated until it's changed.
+  *		If all the speeds are 0, the drone hovers.
+  * \param l_to_r the speed from left to right
+  * \param f_to_b the speed from forward to backward
+  * \param vertical_speed the speed from down to up
+  * \param angular_speed the angular speed to rotate the drone
+  * \return 0 if success, -1 if command couldn't be set.
+  */
+int jakopter_set_move(float l_to_r, float f_to_b, float vertical_speed, float angular_speed)
+{
+	int hover = l_to_r == 0 && f_to_b == 0 && vertical_speed == 0 && angular_speed == 0;
+	return set_pcmd(hover ? "0" : "1", l_to_r, f_to_b, vertical_speed, angular_speed);
+}
+
+/**
+  * \brief Tell when the user input that led to the next command happened,
+  *		to measure the latency until it's sent. Should be called right before setting the command.
+  *		If the previous input hasn't been sent yet, it's kept, since it's the oldest.
+  * \param host_time time of the input, from jakopter_clock_host_now.
+  */
+void jakopter_input_stamp(double host_time)
+{
+	pthread_mutex_lock(&mutex_cmd);
+	if (input_time < 0)
+		input_time = host_time;
+	pthread_mutex_unlock(&mutex_cmd);
+}
+
+/**
+  * \brief Latency between the stamped user inputs and the sending of their command.
+  * \param last receives the latency of the last input, in ms. Can be NULL.
+  * \param mean receives the mean latency, in ms. Can be NULL.
+  * \param max receives the highest latency, in ms. Can be NULL.
+  * \return the number of inputs measured.
+  */
+int jakopter_input_latency(double* last, double* mean, double* max)
+{
+	pthread_mutex_lock(&mutex_cmd);
+	int count = input_latency_count;
+	if (last != NULL)
+		*last = input_latency_last;
+	if (mean != NULL)
+		*mean = count > 0 ? input_latency_sum / count : -1;
+	if (max != NULL)
+		*max = input_latency_max;
+	pthread_mutex_unlock(&mutex_cmd);
+	return count;
+}
+
 /**
   * \brief Stop main thread (End of drone connection)
   * \return pthread_join value or -1 if the communication is already stopped
@@ -0,0 +1,208 @@
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include "navdata.h"
+#include "drone.h"
+#include "video.h"
+
+/*
+* Drone stand-in, for benchmarks without a drone.
+* Sends demo navdata once pinged, takes off and lands on AT*REF,
+* streams a raw H.264 file on the video port, and reports every second
+* how regularly commands come in. Prints the speeds of each new AT*PCMD.
+* Usage : drone_standin [-a address] [-v video.h264] [-r video_kbit/s]
+*/
+
+#define STANDIN_IP "127.0.0.3"
+#define STANDIN_VIDEO_RATE 2000
+//period of the video chunks, in ms
+#define STANDIN_VIDEO_PERIOD 10
+#define STANDIN_NAVDATA_PERIOD (1000/15)
+//REF argument bit that asks for a takeoff
+#define STANDIN_TAKEOFF_BIT (1 << 9)
+#define STANDIN_ALTITUDE 1000
+
+static volatile sig_atomic_t running = 1;
+
+static double now_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000.0 + now.tv_nsec/1000000.0;
+}
+
+static void stop_handler(int sig)
+{
+	running = 0;
+}
+
+static int open_socket(int type, const char* ip, int port)
+{
+	struct sockaddr_in addr;
+	int yes = 1;
+	int fd = socket(AF_INET, type, 0);
+	if(fd < 0)
+		return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr(ip);
+	addr.sin_port = htons(port);
+	if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || (type == SOCK_STREAM && listen(fd, 1) < 0)) {
+		fprintf(stderr, "[standin] Can't bind %s:%d\n", ip, port);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int main(int argc, char** argv)
+{
+	const char* ip = STANDIN_IP;
+	const char* video_path = NULL;
+	double video_rate = STANDIN_VIDEO_RATE;
+	int opt;
+
+	while((opt = getopt(argc, argv, "a:v:r:")) != -1) {
+		switch(opt) {
+			case 'a': ip = optarg; break;
+			case 'v': video_path = optarg; break;
+			case 'r': video_rate = atof(optarg); break;
+			default:
+				fprintf(stderr, "Usage : %s [-a address] [-v video.h264] [-r video_kbit/s]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	FILE* video_file = NULL;
+	if(video_path != NULL && (video_file = fopen(video_path, "rb")) == NULL) {
+		perror("[standin] Can't open the video");
+		return 1;
+	}
+	int nav_fd = open_socket(SOCK_DGRAM, ip, PORT_NAVDATA);
+	int cmd_fd = open_socket(SOCK_DGRAM, ip, PORT_CMD);
+	int video_listen_fd = open_socket(SOCK_STREAM, ip, PORT_VIDEO);
+	int video_fd = -1;
+	if(nav_fd < 0 || cmd_fd < 0 || video_listen_fd < 0)
+		return 1;
+
+	signal(SIGINT, stop_handler);
+	signal(SIGTERM, stop_handler);
+	signal(SIGPIPE, SIG_IGN);
+	printf("[standin] drone stand-in on %s\n", ip);
+
+	union navdata_t data;
+	memset(&data, 0, sizeof(data));
+	data.demo.header = 0x55667788;
+	data.demo.tag = TAG_DEMO;
+	data.demo.size = sizeof(data.demo);
+	data.demo.vbat_flying_percentage = 80;
+
+	//where the navdata go, known once pinged
+	struct sockaddr_in client;
+	int pinged = 0;
+	double next_navdata = 0, next_chunk = 0, next_report = now_ms() + 1000;
+	//commands received during the current second, and the longest gap between two
+	long nb_commands = 0, nb_navdata = 0, video_bytes = 0;
+	double last_command = 0, max_gap = 0;
+	//arguments of the last PCMD, to print only the changes
+	int pcmd[5] = {0, 0, 0, 0, 0};
+	char buffer[PACKET_SIZE*4];
+	static uint8_t chunk[65536];
+
+	while(running) {
+		double now = now_ms();
+		if(pinged && now >= next_navdata) {
+			data.demo.sequence++;
+			data.demo.altitude = (data.demo.ardrone_state & 1) ? STANDIN_ALTITUDE : 0;
+			sendto(nav_fd, &data, sizeof(data), 0, (struct sockaddr*)&client, sizeof(client));
+			nb_navdata++;
+			next_navdata = now + STANDIN_NAVDATA_PERIOD;
+		}
+		if(video_fd >= 0 && video_file != NULL && now >= next_chunk) {
+			size_t size = video_rate*STANDIN_VIDEO_PERIOD/8;
+			if(size > sizeof(chunk))
+				size = sizeof(chunk);
+			size_t got = fread(chunk, 1, size, video_file);
+			//loop over the file
+			if(got < size) {
+				rewind(video_file);
+				got += fread(chunk + got, 1, size - got, video_file);
+			}
+			if(send(video_fd, chunk, got, MSG_NOSIGNAL) < 0) {
+				printf("[standin] video client gone\n");
+				close(video_fd);
+				video_fd = -1;
+			}
+			else
+				video_bytes += got;
+			next_chunk = now + STANDIN_VIDEO_PERIOD;
+		}
+		if(now >= next_report) {
+			printf("[standin] commands %ld/s, max gap %.1f ms | navdata %ld/s | video %.0f kbit/s\n",
+				nb_commands, max_gap, nb_navdata, video_bytes*8/1000.0);
+			fflush(stdout);
+			nb_commands = nb_navdata = video_bytes = 0;
+			max_gap = 0;
+			next_report += 1000;
+		}
+
+		struct pollfd fds[3] = {{nav_fd, POLLIN, 0}, {cmd_fd, POLLIN, 0}, {video_listen_fd, POLLIN, 0}};
+		if(poll(fds, 3, STANDIN_VIDEO_PERIOD) <= 0)
+			continue;
+		now = now_ms();
+
+		if(fds[0].revents & POLLIN) {
+			socklen_t len = sizeof(client);
+			if(recvfrom(nav_fd, buffer, sizeof(buffer), 0, (struct sockaddr*)&client, &len) > 0 && !pinged) {
+				printf("[standin] navdata requested by %s:%d\n", inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+				pinged = 1;
+			}
+		}
+		if(fds[1].revents & POLLIN) {
+			int size = recv(cmd_fd, buffer, sizeof(buffer)-1, 0);
+			if(size > 0) {
+				buffer[size] = '\0';
+				if(last_command > 0 && now - last_command > max_gap)
+					max_gap = now - last_command;
+				last_command = now;
+				nb_commands++;
+				int seq, arg;
+				if(sscanf(buffer, "AT*" HEAD_REF "=%d,%d", &seq, &arg) == 2) {
+					if(arg & STANDIN_TAKEOFF_BIT)
+						data.demo.ardrone_state |= 1;
+					else
+						data.demo.ardrone_state &= ~1;
+				}
+				int args[5];
+				if(sscanf(buffer, "AT*" HEAD_PCMD "=%d,%d,%d,%d,%d,%d", &seq, &args[0], &args[1], &args[2], &args[3], &args[4]) == 6
+					&& memcmp(args, pcmd, sizeof(pcmd)) != 0) {
+					//float arguments are sent as the integers that have the same bits
+					float speeds[4];
+					memcpy(speeds, args + 1, sizeof(speeds));
+					printf("[standin] PCMD %d : %.3f %.3f %.3f %.3f\n", args[0], speeds[0], speeds[1], speeds[2], speeds[3]);
+					fflush(stdout);
+					memcpy(pcmd, args, sizeof(pcmd));
+				}
+			}
+		}
+		if(fds[2].revents & POLLIN) {
+			int fd = accept(video_listen_fd, NULL, NULL);
+			if(fd >= 0) {
+				if(video_fd >= 0)
+					close(video_fd);
+				video_fd = fd;
+				printf("[standin] video client connected\n");
+			}
+		}
+	}
+
+	if(video_fd >= 0)
+		close(video_fd);
+	if(video_file != NULL)
+		fclose(video_file);
+	close(video_listen_fd);
+	close(nav_fd);
+	close(cmd_fd);
+	return 0;
+}
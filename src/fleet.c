@@ -0,0 +1,334 @@
+//for sendmmsg
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <time.h>
+#include "fleet.h"
+#include "clock_sync.h"
+
+struct fleet_drone {
+	struct sockaddr_in addr;
+	//sequence number of the next command
+	int seq;
+	//requested state, and for how many more ticks the emergency is sent
+	int state;
+	int emergency_ticks;
+	float move[4];
+	//datagram of the current tick
+	char packet[PACKET_SIZE];
+};
+
+static struct fleet_drone drones[FLEET_MAX_DRONES];
+static int nb_drones = 0;
+static int sock_fleet = -1;
+//the encoding and sending buffers, built once at connection
+static struct mmsghdr messages[FLEET_MAX_DRONES];
+static struct iovec iovecs[FLEET_MAX_DRONES];
+
+static pthread_t fleet_thread;
+static volatile int stopped = 1;
+static pthread_mutex_t mutex_stopped = PTHREAD_MUTEX_INITIALIZER;
+//guards the drones' commands, so that a group setpoint is never split between two ticks
+static pthread_mutex_t mutex_fleet = PTHREAD_MUTEX_INITIALIZER;
+
+//skew statistics, in us
+static double skew_last = 0, skew_sum = 0, skew_max = 0, late_max = 0;
+static int skew_count = 0;
+static pthread_mutex_t mutex_skew = PTHREAD_MUTEX_INITIALIZER;
+
+
+static int is_stopped()
+{
+	pthread_mutex_lock(&mutex_stopped);
+	int ret = stopped;
+	pthread_mutex_unlock(&mutex_stopped);
+	return ret;
+}
+
+/**
+* Encode the commands of a drone for this tick : the REF that keeps it
+* in the requested state, then its movement.
+* Must be called with mutex_fleet held.
+* \returns the size of the datagram.
+*/
+static int fleet_encode(struct fleet_drone* drone)
+{
+	char* ref_args[1];
+	switch (drone->state) {
+		case FLEET_FLYING:
+			ref_args[0] = takeoff_arg;
+			break;
+		case FLEET_EMERGENCY:
+			ref_args[0] = emergency_arg;
+			if (--drone->emergency_ticks <= 0)
+				drone->state = FLEET_LANDED;
+			break;
+		default:
+			ref_args[0] = land_arg;
+			break;
+	}
+	int len = at_format(drone->packet, PACKET_SIZE, HEAD_REF, drone->seq++, ref_args, 1);
+	if (len < 0 || ref_args[0] == emergency_arg)
+		return len < 0 ? 0 : len;
+
+	//a null movement means hovering, not progressive commands
+	int moving = drone->move[0] != 0 || drone->move[1] != 0 || drone->move[2] != 0 || drone->move[3] != 0;
+	char bufs[4][SIZE_FLOAT_ARG];
+	char* pcmd_args[5];
+	pcmd_args[0] = moving ? "1" : "0";
+	int i = 0;
+	for (i = 0; i < 4; i++) {
+		at_float_arg(bufs[i], drone->move[i]);
+		pcmd_args[i+1] = bufs[i];
+	}
+	int pcmd_len = at_format(drone->packet + len, PACKET_SIZE - len, HEAD_PCMD, drone->seq++, pcmd_args, 5);
+	return pcmd_len < 0 ? len : len + pcmd_len;
+}
+
+/**
+* Hand the whole batch to the kernel. sendmmsg may stop early,
+* e.g. if the socket buffer is full, the rest is sent again.
+*/
+static int fleet_send()
+{
+	int sent = 0;
+	while (sent < nb_drones) {
+		int ret = sendmmsg(sock_fleet, messages + sent, nb_drones - sent, 0);
+		if (ret < 0) {
+			perror("[~][fleet] Can't send the commands");
+			return -1;
+		}
+		sent += ret;
+	}
+	return sent;
+}
+
+static void fleet_tick(double scheduled)
+{
+	int i = 0;
+	pthread_mutex_lock(&mutex_fleet);
+	for (i = 0; i < nb_drones; i++)
+		iovecs[i].iov_len = fleet_encode(&drones[i]);
+	pthread_mutex_unlock(&mutex_fleet);
+
+	double start = jakopter_clock_host_now();
+	if (fleet_send() < 0)
+		return;
+	double end = jakopter_clock_host_now();
+
+	pthread_mutex_lock(&mutex_skew);
+	skew_last = (end - start) * 1000;
+	skew_sum += skew_last;
+	if (skew_last > skew_max)
+		skew_max = skew_last;
+	if ((start - scheduled) * 1000 > late_max)
+		late_max = (start - scheduled) * 1000;
+	skew_count++;
+	pthread_mutex_unlock(&mutex_skew);
+}
+
+/**
+* Shared tick. Deadlines are absolute, so that the period doesn't drift
+* with the time spent sending.
+*/
+static void* fleet_routine(void* args)
+{
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (!is_stopped()) {
+		fleet_tick(next.tv_sec*1000.0 + next.tv_nsec/1000000.0);
+
+		next.tv_nsec += FLEET_TICK;
+		while (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+		//after a long stall, don't send the missed ticks in a burst
+		double now = jakopter_clock_host_now();
+		if (next.tv_sec*1000.0 + next.tv_nsec/1000000.0 < now)
+			clock_gettime(CLOCK_MONOTONIC, &next);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+
+	pthread_exit(NULL);
+}
+
+int jakopter_fleet_connect(const char** ips, int nb)
+{
+	if (!is_stopped()) {
+		fprintf(stderr, "[~][fleet] Already connected\n");
+		return -1;
+	}
+	if (nb <= 0 || nb > FLEET_MAX_DRONES) {
+		fprintf(stderr, "[~][fleet] Invalid number of drones : %d\n", nb);
+		return -1;
+	}
+
+	struct sockaddr_in addr_fleet;
+	addr_fleet.sin_family      = AF_INET;
+	addr_fleet.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr_fleet.sin_port        = htons(PORT_CMD);
+
+	sock_fleet = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock_fleet < 0) {
+		fprintf(stderr, "[~][fleet] Can't establish socket\n");
+		return -1;
+	}
+	jakopter_reuse_port(sock_fleet);
+	if (bind(sock_fleet, (struct sockaddr*)&addr_fleet, sizeof(addr_fleet)) < 0) {
+		fprintf(stderr, "[~][fleet] Can't bind socket to port %d\n", PORT_CMD);
+		close(sock_fleet);
+		return -1;
+	}
+
+	pthread_mutex_lock(&mutex_fleet);
+	memset(drones, 0, sizeof(drones));
+	memset(messages, 0, sizeof(messages));
+	int i = 0;
+	for (i = 0; i < nb; i++) {
+		drones[i].addr.sin_family      = AF_INET;
+		drones[i].addr.sin_addr.s_addr = inet_addr(ips[i]);
+		drones[i].addr.sin_port        = htons(PORT_CMD);
+		drones[i].seq = 1;
+		drones[i].state = FLEET_LANDED;
+		iovecs[i].iov_base = drones[i].packet;
+		messages[i].msg_hdr.msg_name = &drones[i].addr;
+		messages[i].msg_hdr.msg_namelen = sizeof(drones[i].addr);
+		messages[i].msg_hdr.msg_iov = &iovecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+	nb_drones = nb;
+	pthread_mutex_unlock(&mutex_fleet);
+
+	pthread_mutex_lock(&mutex_skew);
+	skew_last = skew_sum = skew_max = late_max = 0;
+	skew_count = 0;
+	pthread_mutex_unlock(&mutex_skew);
+
+	pthread_mutex_lock(&mutex_stopped);
+	stopped = 0;
+	pthread_mutex_unlock(&mutex_stopped);
+
+	if (pthread_create(&fleet_thread, NULL, fleet_routine, NULL) < 0) {
+		perror("[~][fleet] Can't create thread");
+		pthread_mutex_lock(&mutex_stopped);
+		stopped = 1;
+		pthread_mutex_unlock(&mutex_stopped);
+		close(sock_fleet);
+		return -1;
+	}
+
+	return 0;
+}
+
+int jakopter_fleet_disconnect()
+{
+	if (is_stopped())
+		return -1;
+
+	//give the flying drones the time to get the landing order
+	int i = 0, flying = 0;
+	pthread_mutex_lock(&mutex_fleet);
+	for (i = 0; i < nb_drones; i++) {
+		if (drones[i].state == FLEET_FLYING) {
+			drones[i].state = FLEET_LANDED;
+			flying = 1;
+		}
+		memset(drones[i].move, 0, sizeof(drones[i].move));
+	}
+	pthread_mutex_unlock(&mutex_fleet);
+	if (flying) {
+		long long ns = (long long)FLEET_LANDING_TICKS*FLEET_TICK;
+		struct timespec wait = {ns / 1000000000, ns % 1000000000};
+		nanosleep(&wait, NULL);
+	}
+
+	pthread_mutex_lock(&mutex_stopped);
+	stopped = 1;
+	pthread_mutex_unlock(&mutex_stopped);
+
+	int ret = pthread_join(fleet_thread, NULL);
+	close(sock_fleet);
+	sock_fleet = -1;
+
+	return ret;
+}
+
+int jakopter_fleet_set_moves(const jakopter_fleet_setpoint_t* setpoints, int nb)
+{
+	if (is_stopped())
+		return -1;
+
+	int i = 0;
+	pthread_mutex_lock(&mutex_fleet);
+	for (i = 0; i < nb; i++)
+		if (setpoints[i].drone < 0 || setpoints[i].drone >= nb_drones) {
+			pthread_mutex_unlock(&mutex_fleet);
+			fprintf(stderr, "[~][fleet] Invalid drone : %d\n", setpoints[i].drone);
+			return -1;
+		}
+
+	for (i = 0; i < nb; i++) {
+		float* move = drones[setpoints[i].drone].move;
+		move[0] = setpoints[i].l_to_r;
+		move[1] = setpoints[i].f_to_b;
+		move[2] = setpoints[i].vertical_speed;
+		move[3] = setpoints[i].angular_speed;
+	}
+	pthread_mutex_unlock(&mutex_fleet);
+	return 0;
+}
+
+int jakopter_fleet_group_move(uint32_t group, float l_to_r, float f_to_b, float vertical_speed, float angular_speed)
+{
+	if (is_stopped())
+		return -1;
+
+	int i = 0;
+	pthread_mutex_lock(&mutex_fleet);
+	for (i = 0; i < nb_drones; i++) {
+		if (!(group & (1U << i)))
+			continue;
+		drones[i].move[0] = l_to_r;
+		drones[i].move[1] = f_to_b;
+		drones[i].move[2] = vertical_speed;
+		drones[i].move[3] = angular_speed;
+	}
+	pthread_mutex_unlock(&mutex_fleet);
+	return 0;
+}
+
+int jakopter_fleet_group_state(uint32_t group, int state)
+{
+	if (is_stopped() || state < FLEET_LANDED || state > FLEET_EMERGENCY)
+		return -1;
+
+	int i = 0;
+	pthread_mutex_lock(&mutex_fleet);
+	for (i = 0; i < nb_drones; i++) {
+		if (!(group & (1U << i)))
+			continue;
+		drones[i].state = state;
+		drones[i].emergency_ticks = FLEET_EMERGENCY_TICKS;
+		//a drone that takes off or lands starts hovering
+		memset(drones[i].move, 0, sizeof(drones[i].move));
+	}
+	pthread_mutex_unlock(&mutex_fleet);
+	return 0;
+}
+
+int jakopter_fleet_skew(double* last, double* mean, double* max, double* late)
+{
+	pthread_mutex_lock(&mutex_skew);
+	if (last != NULL)
+		*last = skew_last;
+	if (mean != NULL)
+		*mean = skew_count > 0 ? skew_sum / skew_count : 0;
+	if (max != NULL)
+		*max = skew_max;
+	if (late != NULL)
+		*late = late_max;
+	int count = skew_count;
+	pthread_mutex_unlock(&mutex_skew);
+	return count;
+}
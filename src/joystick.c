@@ -0,0 +1,429 @@
+#include "common.h"
+#include "joystick.h"
+#include "drone.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+//helpers to test the capability bits returned by EVIOCGBIT
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
+#define TEST_BIT(bit, array) ((array[(bit)/BITS_PER_LONG] >> ((bit)%BITS_PER_LONG)) & 1)
+
+/**
+* An opened input device, with the range of each of its axes.
+*/
+typedef struct joystick_device {
+	int fd;
+	struct input_absinfo abs[ABS_CNT];
+} joystick_device_t;
+
+static joystick_device_t devices[JOYSTICK_MAX_DEVICES];
+static int nb_devices = 0;
+static int epoll_fd = -1;
+
+/*Evdev axis driving each drone axis, and whether it's reversed.
+Default : mode 2 gamepad.*/
+static struct {
+	int code;
+	int invert;
+} axis_map[JOY_NB_AXES] = {
+	{ABS_RX, 0}, //roll : right stick, right = positive
+	{ABS_RY, 0}, //pitch : right stick, up = negative = forward
+	{ABS_Y, 1}, //throttle : left stick, up = negative, so reverse it
+	{ABS_X, 0} //yaw : left stick, right = positive
+};
+//current position of each drone axis, in [-1, 1], before shaping.
+static float axis_values[JOY_NB_AXES];
+//set when an axis has moved since the last setpoint was written
+static int axes_changed = 0;
+
+static float deadzone = JOYSTICK_DEADZONE;
+static float expo = JOYSTICK_EXPO;
+//protect the mapping, the curve and the axes, which can be changed while the thread runs
+static pthread_mutex_t mutex_joystick = PTHREAD_MUTEX_INITIALIZER;
+//set while a takeoff or a landing is in progress, protected by mutex_joystick
+static int action_running = 0;
+
+pthread_t joystick_thread;
+static bool stopped_joystick = true;
+static pthread_mutex_t mutex_stopped_joystick = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+* \brief Open an input device and register it in the epoll set.
+* \param path path of the device.
+* \param check if true, only accept the device if it's a joystick or a gamepad.
+* \returns 0 on success, -1 otherwise.
+*/
+static int joystick_open_device(const char* path, bool check)
+{
+	if (nb_devices >= JOYSTICK_MAX_DEVICES)
+		return -1;
+
+	int fd = open(path, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -1;
+
+	unsigned long keybits[NBITS(KEY_CNT)];
+	unsigned long absbits[NBITS(ABS_CNT)];
+	memset(keybits, 0, sizeof(keybits));
+	memset(absbits, 0, sizeof(absbits));
+	if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits) < 0 ||
+		ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absbits)), absbits) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	if (check && !TEST_BIT(BTN_GAMEPAD, keybits) && !TEST_BIT(BTN_JOYSTICK, keybits)) {
+		close(fd);
+		return -1;
+	}
+
+	joystick_device_t* dev = &devices[nb_devices];
+	memset(dev->abs, 0, sizeof(dev->abs));
+	int code = 0;
+	for (code = 0; code < ABS_CNT; code++)
+		if (TEST_BIT(code, absbits))
+			ioctl(fd, EVIOCGABS(code), &dev->abs[code]);
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u32 = nb_devices;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		perror("[~][joystick] Can't watch device");
+		close(fd);
+		return -1;
+	}
+
+	char name[64] = "unknown";
+	ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+	printf("[joystick] using %s (%s)\n", path, name);
+
+	dev->fd = fd;
+	nb_devices++;
+	return 0;
+}
+
+/**
+* \brief Open every joystick and gamepad in JOYSTICK_DEV_DIR.
+* \returns the number of devices opened.
+*/
+static int joystick_scan_devices()
+{
+	DIR* dir = opendir(JOYSTICK_DEV_DIR);
+	if (dir == NULL) {
+		perror("[~][joystick] Can't open " JOYSTICK_DEV_DIR);
+		return 0;
+	}
+
+	struct dirent* entry;
+	char path[PATH_MAX];
+	int nb = 0;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "event", 5) != 0)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", JOYSTICK_DEV_DIR, entry->d_name);
+		if (joystick_open_device(path, true) == 0)
+			nb++;
+	}
+
+	closedir(dir);
+	return nb;
+}
+
+static void joystick_close_devices()
+{
+	int i = 0;
+	for (i = 0; i < nb_devices; i++)
+		if (devices[i].fd >= 0)
+			close(devices[i].fd);
+	nb_devices = 0;
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+	epoll_fd = -1;
+}
+
+/**
+* \brief Apply the deadzone and the expo curve to a stick value.
+*/
+static float joystick_shape(float value)
+{
+	float a = value < 0 ? -value : value;
+	if (a <= deadzone)
+		return 0;
+	//rescale so that the output starts at 0 right out of the deadzone
+	a = (a - deadzone) / (1 - deadzone);
+	if (a > 1)
+		a = 1;
+	a = expo*a*a*a + (1 - expo)*a;
+	return value < 0 ? -a : a;
+}
+
+/**
+* \brief Convert a raw axis value to [-1, 1], according to the axis' range.
+*/
+static float joystick_normalize(const struct input_absinfo* info, int value)
+{
+	if (info->maximum <= info->minimum)
+		return 0;
+	float center = (info->maximum + info->minimum) / 2.f;
+	float half_range = (info->maximum - info->minimum) / 2.f;
+	float v = (value - center) / half_range;
+	return v < -1 ? -1 : (v > 1 ? 1 : v);
+}
+
+/**
+* Buttons that trigger a blocking command. Takeoff and landing wait
+* for the navdata for several seconds, so each command runs in its
+* own thread : the sticks stay live, and an emergency press is handled
+* right away, even during a takeoff or a landing.
+*/
+static void* joystick_action_routine(void* args)
+{
+	switch ((intptr_t)args) {
+		case BTN_START:
+			jakopter_takeoff();
+			break;
+		case BTN_SELECT:
+			jakopter_land();
+			break;
+		case BTN_MODE:
+			jakopter_emergency();
+			//emergency doesn't hold the action slot
+			pthread_exit(NULL);
+		default:
+			break;
+	}
+	pthread_mutex_lock(&mutex_joystick);
+	action_running = 0;
+	//the command slot has been reset, give it the sticks' position again
+	axes_changed = 1;
+	pthread_mutex_unlock(&mutex_joystick);
+	pthread_exit(NULL);
+}
+
+static void joystick_handle_button(int code)
+{
+	if (code != BTN_START && code != BTN_SELECT && code != BTN_MODE)
+		return;
+
+	//only one takeoff or landing at a time, but emergency always goes through
+	pthread_mutex_lock(&mutex_joystick);
+	if (code != BTN_MODE) {
+		if (action_running) {
+			pthread_mutex_unlock(&mutex_joystick);
+			return;
+		}
+		action_running = 1;
+	}
+	pthread_mutex_unlock(&mutex_joystick);
+
+	pthread_t thread;
+	pthread_attr_t attribs;
+	pthread_attr_init(&attribs);
+	pthread_attr_setdetachstate(&attribs, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attribs, joystick_action_routine, (void*)(intptr_t)code) != 0) {
+		perror("[~][joystick] Can't create the action thread");
+		if (code == BTN_MODE)
+			//last resort : don't lose an emergency
+			jakopter_emergency();
+		else {
+			pthread_mutex_lock(&mutex_joystick);
+			action_running = 0;
+			pthread_mutex_unlock(&mutex_joystick);
+		}
+	}
+	pthread_attr_destroy(&attribs);
+}
+
+/**
+* \brief Read the pending events of a device and update the axes.
+* \returns 0 on success, -1 if the device is gone.
+*/
+static int joystick_read_device(joystick_device_t* dev)
+{
+	struct input_event events[64];
+	ssize_t len;
+	while ((len = read(dev->fd, events, sizeof(events))) > 0) {
+		int nb = len / sizeof(struct input_event);
+		int i = 0, axis = 0;
+		for (i = 0; i < nb; i++) {
+			struct input_event* ev = &events[i];
+			if (ev->type == EV_ABS && ev->code < ABS_CNT) {
+				pthread_mutex_lock(&mutex_joystick);
+				for (axis = 0; axis < JOY_NB_AXES; axis++)
+					if (axis_map[axis].code == ev->code) {
+						float v = joystick_normalize(&dev->abs[ev->code], ev->value);
+						axis_values[axis] = axis_map[axis].invert ? -v : v;
+						axes_changed = 1;
+					}
+				pthread_mutex_unlock(&mutex_joystick);
+			}
+			//only react to presses, not releases or autorepeat
+			else if (ev->type == EV_KEY && ev->value == 1)
+				joystick_handle_button(ev->code);
+		}
+	}
+
+	if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		return -1;
+	return 0;
+}
+
+/**
+* \brief Write the current shaped stick positions into the command slot,
+*		if they've changed since the last time.
+*		Nothing is written during a takeoff or a landing, which use the slot;
+*		the position is written again once it's over.
+*/
+static void joystick_write_setpoint()
+{
+	float s[JOY_NB_AXES];
+	int axis = 0;
+	pthread_mutex_lock(&mutex_joystick);
+	if (!axes_changed || action_running) {
+		pthread_mutex_unlock(&mutex_joystick);
+		return;
+	}
+	for (axis = 0; axis < JOY_NB_AXES; axis++)
+		s[axis] = joystick_shape(axis_values[axis]);
+	axes_changed = 0;
+	pthread_mutex_unlock(&mutex_joystick);
+
+	jakopter_set_move(s[JOY_ROLL], s[JOY_PITCH], s[JOY_THROTTLE], s[JOY_YAW]);
+}
+
+/*joystick_thread function*/
+void* joystick_routine(void* args)
+{
+	struct epoll_event events[JOYSTICK_MAX_DEVICES];
+	//wake up at least once per command tick
+	int timeout = TIMEOUT_CMD / 1000000;
+	int i = 0;
+
+	pthread_mutex_lock(&mutex_stopped_joystick);
+	while (!stopped_joystick) {
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+
+		int nb = epoll_wait(epoll_fd, events, JOYSTICK_MAX_DEVICES, timeout);
+		if (nb < 0 && errno != EINTR)
+			perror("[~][joystick] epoll_wait failed");
+
+		for (i = 0; i < nb; i++) {
+			joystick_device_t* dev = &devices[events[i].data.u32];
+			if (joystick_read_device(dev) < 0 || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+				fprintf(stderr, "[~][joystick] Device lost, hovering.\n");
+				epoll_ctl(epoll_fd, EPOLL_CTL_DEL, dev->fd, NULL);
+				close(dev->fd);
+				dev->fd = -1;
+				//don't keep flying with the last stick position
+				pthread_mutex_lock(&mutex_joystick);
+				memset(axis_values, 0, sizeof(axis_values));
+				axes_changed = 1;
+				pthread_mutex_unlock(&mutex_joystick);
+			}
+		}
+
+		joystick_write_setpoint();
+
+		pthread_mutex_lock(&mutex_stopped_joystick);
+	}
+	pthread_mutex_unlock(&mutex_stopped_joystick);
+
+	pthread_exit(NULL);
+}
+
+int jakopter_joystick_connect(const char* device)
+{
+	pthread_mutex_lock(&mutex_stopped_joystick);
+	if (!stopped_joystick) {
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+		fprintf(stderr, "[~][joystick] Already connected\n");
+		return -1;
+	}
+
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd < 0) {
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+		perror("[~][joystick] Can't create epoll instance");
+		return -1;
+	}
+
+	int nb = 0;
+	if (device != NULL)
+		nb = joystick_open_device(device, false) == 0 ? 1 : 0;
+	else
+		nb = joystick_scan_devices();
+
+	if (nb == 0) {
+		joystick_close_devices();
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+		fprintf(stderr, "[~][joystick] No usable input device found\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&mutex_joystick);
+	memset(axis_values, 0, sizeof(axis_values));
+	axes_changed = 0;
+	pthread_mutex_unlock(&mutex_joystick);
+	stopped_joystick = false;
+
+	if (pthread_create(&joystick_thread, NULL, joystick_routine, NULL) < 0) {
+		perror("[~][joystick] Can't create thread");
+		stopped_joystick = true;
+		joystick_close_devices();
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+		return -1;
+	}
+	pthread_mutex_unlock(&mutex_stopped_joystick);
+
+	return 0;
+}
+
+int jakopter_joystick_disconnect()
+{
+	pthread_mutex_lock(&mutex_stopped_joystick);
+	if (!stopped_joystick) {
+		stopped_joystick = true;
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+		int ret = pthread_join(joystick_thread, NULL);
+
+		joystick_close_devices();
+		jakopter_set_move(0, 0, 0, 0);
+
+		return ret;
+	}
+	else {
+		pthread_mutex_unlock(&mutex_stopped_joystick);
+
+		fprintf(stderr, "[~][joystick] Joystick already disconnected\n");
+		return -1;
+	}
+}
+
+int jakopter_joystick_map_axis(int axis, int code, int invert)
+{
+	if (axis < 0 || axis >= JOY_NB_AXES || code < 0 || code >= ABS_CNT)
+		return -1;
+
+	pthread_mutex_lock(&mutex_joystick);
+	axis_map[axis].code = code;
+	axis_map[axis].invert = invert;
+	axis_values[axis] = 0;
+	pthread_mutex_unlock(&mutex_joystick);
+	return 0;
+}
+
+void jakopter_joystick_set_curve(float new_deadzone, float new_expo)
+{
+	pthread_mutex_lock(&mutex_joystick);
+	if (new_deadzone >= 0 && new_deadzone < 1)
+		deadzone = new_deadzone;
+	if (new_expo >= 0 && new_expo <= 1)
+		expo = new_expo;
+	pthread_mutex_unlock(&mutex_joystick);
+}
@@ -2,9 +2,22 @@
 #include "navdata.h"
 #ifdef WITH_VIDEO
 #include "video.h"
+#include "video_keyboard.h"
+#include "video_quality.h"
+#include "video_display.h"
+#endif
+#ifdef WITH_VIDEO_CLIP
+#include "video_clip.h"
+#endif
+#ifdef WITH_JOYSTICK
+#include "joystick.h"
 #endif
 #include "com_channel.h"
 #include "com_master.h"
+#include "clock_sync.h"
+#include "actuation.h"
+#include "fleet.h"
+#include "plugin.h"
 //pour le yield
 #include <sched.h>
 #include "lauxlib.h"
@@ -96,7 +109,332 @@ int jakopter_stop_video_lua(lua_State* L) {
 	lua_pushnumber(L, jakopter_stop_video());
 	return 1;
 }
+
+int jakopter_video_set_camera_lua(lua_State* L) {
+	lua_Integer camera = luaL_checkinteger(L, 1);
+	lua_pushnumber(L, jakopter_video_set_camera(camera));
+	return 1;
+}
+
+int jakopter_video_get_switch_latency_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_video_get_switch_latency());
+	return 1;
+}
+
+/**
+* \brief Enable or disable keyboard control from the video window.
+* \param enabled boolean.
+*/
+int jakopter_keyboard_enable_lua(lua_State* L) {
+	jakopter_keyboard_enable(lua_toboolean(L, 1));
+	return 0;
+}
+
+/**
+* \brief Drop bad frames before they're processed, see jakopter_video_quality_filter.
+* \param min_sharpness, max_clipped, max_corruption thresholds, all optional (no filtering).
+*/
+int jakopter_video_quality_filter_lua(lua_State* L) {
+	float min_sharpness = luaL_optnumber(L, 1, 0);
+	float max_clipped = luaL_optnumber(L, 2, 1);
+	float max_corruption = luaL_optnumber(L, 3, 1);
+	jakopter_video_quality_filter(min_sharpness, max_clipped, max_corruption);
+	return 0;
+}
+
+/**
+* \brief Latency of the video frames, from the reception of their last bytes to their processing.
+* \returns last, mean and max latencies in ms, and the number of frames measured.
+*/
+int jakopter_video_latency_lua(lua_State* L) {
+	double last, mean, max;
+	int count = jakopter_video_latency(&last, &mean, &max);
+	lua_pushnumber(L, last);
+	lua_pushnumber(L, mean);
+	lua_pushnumber(L, max);
+	lua_pushnumber(L, count);
+	return 4;
+}
+
+/**
+* \brief Quality metrics of the last processed frame.
+* \returns sharpness, brightness, underexposed and overexposed fractions, corruption,
+*		and the number of frames dropped by the filter ; nil if no frame has been processed yet.
+*/
+int jakopter_video_get_quality_lua(lua_State* L) {
+	jakopter_video_quality_t quality;
+	int dropped = jakopter_video_get_quality(&quality);
+	if (dropped < 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_pushnumber(L, quality.sharpness);
+	lua_pushnumber(L, quality.brightness);
+	lua_pushnumber(L, quality.underexposed);
+	lua_pushnumber(L, quality.overexposed);
+	lua_pushnumber(L, quality.corruption);
+	lua_pushnumber(L, dropped);
+	return 6;
+}
+
+/**
+* \brief Show a frame in the video window, see jakopter_display_submit.
+* \param stream index of the stream, 0 being the drone's video.
+* \param pixels string holding the YUV420p frame.
+* \param width, height size of the frame.
+* \returns 0 on success, -1 on error.
+*/
+int jakopter_display_submit_lua(lua_State* L) {
+	size_t size;
+	int stream = luaL_checkinteger(L, 1);
+	const char* pixels = luaL_checklstring(L, 2, &size);
+	int width = luaL_checkinteger(L, 3);
+	int height = luaL_checkinteger(L, 4);
+	luaL_argcheck(L, width > 0 && height > 0 && size >= (size_t)width*height*3/2, 2, "too small for a YUV420p frame");
+	lua_pushnumber(L, jakopter_display_submit(stream, (uint8_t*)pixels, width, height, size));
+	return 1;
+}
+
+/**
+* \brief Set the flight informations drawn over a stream.
+* \param stream index of the stream.
+* \param bat, alt, pitch, roll, yaw, speed the informations, angles in degrees. Omitted ones are 0.
+* \returns 0 on success, -1 on error.
+*/
+int jakopter_display_set_hud_lua(lua_State* L) {
+	video_display_hud_t hud;
+	int stream = luaL_checkinteger(L, 1);
+	hud.bat = luaL_optinteger(L, 2, 0);
+	hud.alt = luaL_optinteger(L, 3, 0);
+	hud.pitch = luaL_optnumber(L, 4, 0);
+	hud.roll = luaL_optnumber(L, 5, 0);
+	hud.yaw = luaL_optnumber(L, 6, 0);
+	hud.speed = luaL_optnumber(L, 7, 0);
+	lua_pushnumber(L, jakopter_display_set_hud(stream, &hud));
+	return 1;
+}
+
+/**
+* \brief Stop showing a stream.
+* \returns 0 on success, -1 on error.
+*/
+int jakopter_display_remove_stream_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_display_remove_stream(luaL_checkinteger(L, 1)));
+	return 1;
+}
+
+/**
+* \brief Choose how the streams are arranged in the window.
+* \param layout "grid" or "pip".
+* \returns 0 on success, -1 on error.
+*/
+int jakopter_display_set_layout_lua(lua_State* L) {
+	static const char* layouts[] = {"grid", "pip", NULL};
+	static const int values[] = {DISPLAY_LAYOUT_GRID, DISPLAY_LAYOUT_PIP};
+	lua_pushnumber(L, jakopter_display_set_layout(values[luaL_checkoption(L, 1, NULL, layouts)]));
+	return 1;
+}
+#endif
+
+#ifdef WITH_VIDEO_CLIP
+/**
+* \brief Save a clip of the video around the current time.
+* \param before seconds before now (optional).
+* \param after seconds after now (optional).
+*/
+int jakopter_video_clip_lua(lua_State* L) {
+	double before = luaL_optnumber(L, 1, CLIP_DEFAULT_BEFORE);
+	double after = luaL_optnumber(L, 2, CLIP_DEFAULT_AFTER);
+	lua_pushnumber(L, jakopter_video_clip(before, after));
+	return 1;
+}
+
+int jakopter_video_clip_on_state_lua(lua_State* L) {
+	jakopter_video_clip_on_state((uint32_t)luaL_checknumber(L, 1));
+	return 0;
+}
+#endif
+
+#ifdef WITH_JOYSTICK
+/**
+* \brief Start joystick control.
+* \param device path of the evdev device to use (optional, all joysticks if omitted).
+*/
+int jakopter_joystick_connect_lua(lua_State* L) {
+	const char* device = luaL_optstring(L, 1, NULL);
+	lua_pushnumber(L, jakopter_joystick_connect(device));
+	return 1;
+}
+
+int jakopter_joystick_disconnect_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_joystick_disconnect());
+	return 1;
+}
+#endif
+
+/**
+* \brief Get the drone/host clock estimation.
+* \returns offset, drift and bound in ms, or nil if it isn't valid yet.
+*/
+int jakopter_clock_get_sync_lua(lua_State* L) {
+	double offset, drift, bound;
+	if (jakopter_clock_get_sync(&offset, &drift, &bound) < 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_pushnumber(L, offset);
+	lua_pushnumber(L, drift);
+	lua_pushnumber(L, bound);
+	return 3;
+}
+
+int jakopter_clock_drone_to_host_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_clock_drone_to_host(luaL_checknumber(L, 1)));
+	return 1;
+}
+
+int jakopter_clock_host_to_drone_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_clock_host_to_drone(luaL_checknumber(L, 1)));
+	return 1;
+}
+
+int jakopter_clock_host_now_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_clock_host_now());
+	return 1;
+}
+
+/**
+* \brief Latency between user inputs and the sending of their command.
+* \returns last, mean and max latencies in ms, and the number of inputs measured.
+*/
+int jakopter_input_latency_lua(lua_State* L) {
+	double last, mean, max;
+	int count = jakopter_input_latency(&last, &mean, &max);
+	lua_pushnumber(L, last);
+	lua_pushnumber(L, mean);
+	lua_pushnumber(L, max);
+	lua_pushnumber(L, count);
+	return 4;
+}
+
+/**
+* \brief Identified response of an axis to movement commands.
+* \param axis 0 roll, 1 pitch, 2 vertical, 3 yaw.
+* \returns dead time and time constant in ms, gain, and the number of steps they're based on.
+*/
+int jakopter_actuation_get_lua(lua_State* L) {
+	jakopter_actuation_t estimation;
+	int nb = jakopter_actuation_get(luaL_checkinteger(L, 1), &estimation);
+	luaL_argcheck(L, nb >= 0, 1, "invalid axis");
+	lua_pushnumber(L, estimation.dead_time);
+	lua_pushnumber(L, estimation.tau);
+	lua_pushnumber(L, estimation.gain);
+	lua_pushnumber(L, nb);
+	return 4;
+}
+
+/**
+* \brief Start the fleet sender.
+* \param ... addresses of the drones. Drones are then numbered from 0, in that order.
+*/
+int jakopter_fleet_connect_lua(lua_State* L) {
+	const char* ips[FLEET_MAX_DRONES];
+	int nb = lua_gettop(L);
+	luaL_argcheck(L, nb > 0 && nb <= FLEET_MAX_DRONES, 1, "1 to FLEET_MAX_DRONES addresses expected");
+	int i = 0;
+	for (i = 0; i < nb; i++)
+		ips[i] = luaL_checkstring(L, i+1);
+	lua_pushnumber(L, jakopter_fleet_connect(ips, nb));
+	return 1;
+}
+
+int jakopter_fleet_disconnect_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_fleet_disconnect());
+	return 1;
+}
+
+/**
+* \brief Give the same movement to a group of drones.
+* \param group mask of the drones (bit i = drone i).
+*/
+int jakopter_fleet_group_move_lua(lua_State* L) {
+	uint32_t group = luaL_checknumber(L, 1);
+	float l = luaL_checknumber(L, 2);
+	float f = luaL_checknumber(L, 3);
+	float v = luaL_checknumber(L, 4);
+	float a = luaL_checknumber(L, 5);
+	lua_pushnumber(L, jakopter_fleet_group_move(group, l, f, v, a));
+	return 1;
+}
+
+/**
+* \brief Set the movements of several drones, applied on the same tick.
+* \param setpoints table of {drone, l_to_r, f_to_b, vertical_speed, angular_speed}.
+*/
+int jakopter_fleet_set_moves_lua(lua_State* L) {
+	jakopter_fleet_setpoint_t setpoints[FLEET_MAX_DRONES];
+	luaL_checktype(L, 1, LUA_TTABLE);
+#if LUA_VERSION_NUM <= 501
+	int nb = lua_objlen(L, 1);
+#else
+	int nb = lua_rawlen(L, 1);
 #endif
+	luaL_argcheck(L, nb <= FLEET_MAX_DRONES, 1, "too many setpoints");
+	int i = 0;
+	for (i = 0; i < nb; i++) {
+		lua_rawgeti(L, 1, i+1);
+		luaL_checktype(L, -1, LUA_TTABLE);
+		float values[5];
+		int j = 0;
+		for (j = 0; j < 5; j++) {
+			lua_rawgeti(L, -1, j+1);
+			values[j] = luaL_checknumber(L, -1);
+			lua_pop(L, 1);
+		}
+		lua_pop(L, 1);
+		setpoints[i].drone = values[0];
+		setpoints[i].l_to_r = values[1];
+		setpoints[i].f_to_b = values[2];
+		setpoints[i].vertical_speed = values[3];
+		setpoints[i].angular_speed = values[4];
+	}
+	lua_pushnumber(L, jakopter_fleet_set_moves(setpoints, nb));
+	return 1;
+}
+
+/**
+* \brief Take off, land or cut the motors of a group of drones.
+* \param group mask of the drones, all of them if omitted.
+*/
+int jakopter_fleet_takeoff_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_fleet_group_state(luaL_optnumber(L, 1, FLEET_ALL), FLEET_FLYING));
+	return 1;
+}
+
+int jakopter_fleet_land_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_fleet_group_state(luaL_optnumber(L, 1, FLEET_ALL), FLEET_LANDED));
+	return 1;
+}
+
+int jakopter_fleet_emergency_lua(lua_State* L) {
+	lua_pushnumber(L, jakopter_fleet_group_state(luaL_optnumber(L, 1, FLEET_ALL), FLEET_EMERGENCY));
+	return 1;
+}
+
+/**
+* \brief Skew of the fleet's ticks.
+* \returns last, mean and max skew, worst tick lateness, in us, and the number of ticks.
+*/
+int jakopter_fleet_skew_lua(lua_State* L) {
+	double last, mean, max, late;
+	int count = jakopter_fleet_skew(&last, &mean, &max, &late);
+	lua_pushnumber(L, last);
+	lua_pushnumber(L, mean);
+	lua_pushnumber(L, max);
+	lua_pushnumber(L, late);
+	lua_pushnumber(L, count);
+	return 5;
+}
 
 int jakopter_is_flying_lua(lua_State* L){
 	lua_pushnumber(L, jakopter_is_flying());
@@ -133,6 +471,21 @@ int jakopter_move_lua(lua_State* L){
 	return 1;
 }
 
+/**
+* \brief Set the movement without waiting, see jakopter_set_move.
+*		The call is stamped as a user input, so its latency is counted in input_latency.
+*/
+int jakopter_set_move_lua(lua_State* L){
+	float l = luaL_checknumber(L, 1);
+	float f = luaL_checknumber(L, 2);
+	float v = luaL_checknumber(L, 3);
+	float a = luaL_checknumber(L, 4);
+
+	jakopter_input_stamp(jakopter_clock_host_now());
+	lua_pushnumber(L, jakopter_set_move(l,f,v,a));
+	return 1;
+}
+
 int jakopter_stay_lua(lua_State* L){
 	lua_pushnumber(L, jakopter_stay());
 	return 1;
@@ -290,6 +643,24 @@ static const luaL_Reg jakopterlib[] = {
 #ifdef WITH_VIDEO
 	{"connect_video", jakopter_init_video_lua},
 	{"stop_video", jakopter_stop_video_lua},
+	{"set_camera", jakopter_video_set_camera_lua},
+	{"switch_latency", jakopter_video_get_switch_latency_lua},
+	{"keyboard_control", jakopter_keyboard_enable_lua},
+	{"quality_filter", jakopter_video_quality_filter_lua},
+	{"video_quality", jakopter_video_get_quality_lua},
+	{"video_latency", jakopter_video_latency_lua},
+	{"display_submit", jakopter_display_submit_lua},
+	{"display_hud", jakopter_display_set_hud_lua},
+	{"display_remove", jakopter_display_remove_stream_lua},
+	{"display_layout", jakopter_display_set_layout_lua},
+#endif
+#ifdef WITH_VIDEO_CLIP
+	{"clip", jakopter_video_clip_lua},
+	{"clip_on_state", jakopter_video_clip_on_state_lua},
+#endif
+#ifdef WITH_JOYSTICK
+	{"connect_joystick", jakopter_joystick_connect_lua},
+	{"stop_joystick", jakopter_joystick_disconnect_lua},
 #endif
 	{"is_flying", jakopter_is_flying_lua},
 	{"height", jakopter_height_lua},
@@ -297,8 +668,19 @@ static const luaL_Reg jakopterlib[] = {
 	{"ftrim", jakopter_ftrim_lua},
 	{"calib", jakopter_calib_lua},
 	{"move", jakopter_move_lua},
+	{"set_move", jakopter_set_move_lua},
 	{"stay", jakopter_stay_lua},
 	{"emergency", jakopter_emergency_lua},
+	{"input_latency", jakopter_input_latency_lua},
+	{"actuation", jakopter_actuation_get_lua},
+	{"fleet_connect", jakopter_fleet_connect_lua},
+	{"fleet_disconnect", jakopter_fleet_disconnect_lua},
+	{"fleet_move", jakopter_fleet_group_move_lua},
+	{"fleet_moves", jakopter_fleet_set_moves_lua},
+	{"fleet_takeoff", jakopter_fleet_takeoff_lua},
+	{"fleet_land", jakopter_fleet_land_lua},
+	{"fleet_emergency", jakopter_fleet_emergency_lua},
+	{"fleet_skew", jakopter_fleet_skew_lua},
 	//we don't need to create/destroy channels in lua.
 /*	{"create_cc", jakopter_com_create_channel_lua},
 	{"destroy_cc", jakopter_com_destroy_channel_lua},*/
@@ -309,6 +691,10 @@ static const luaL_Reg jakopterlib[] = {
 	{"cc_write_int", jakopter_com_write_int_lua},
 	{"cc_write_float", jakopter_com_write_float_lua},
 	{"cc_get_timestamp", jakopter_com_get_timestamp_lua},
+	{"clock_sync", jakopter_clock_get_sync_lua},
+	{"drone_to_host", jakopter_clock_drone_to_host_lua},
+	{"host_to_drone", jakopter_clock_host_to_drone_lua},
+	{"host_now", jakopter_clock_host_now_lua},
 	{"usleep", usleep_lua},
 	{"yield", yield_lua},
 	{NULL, NULL}
@@ -339,7 +725,7 @@ int create_cleanup_udata(lua_State* L) {
 	return 0;
 }
 
-int luaopen_libjakopter(lua_State* L) {
+static int lua_bindings_open(lua_State* L) {
 	//the metatable is used for type-checking our custom structs in lua.
 	//here, define a table for com channels pointers.
 	luaL_newmetatable(L, "jakopter.com_channel");
@@ -357,3 +743,15 @@ int luaopen_libjakopter(lua_State* L) {
 	return 1;
 }
 
+static int lua_plugin_open(void* L) {
+	return lua_bindings_open((lua_State*)L);
+}
+
+/*
+The module's table. The core's luaopen_libjakopter forwards to it,
+so that Lua is only loaded by the programs that use it.
+*/
+JAKOPTER_PLUGIN_EXPORT const jakopter_lua_plugin_t jakopter_lua_plugin = {
+	JAKOPTER_PLUGIN_VERSION,
+	lua_plugin_open
+};
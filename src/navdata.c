@@ -1,6 +1,11 @@
 #include "common.h"
 #include "navdata.h"
 #include "drone.h"
+#include "clock_sync.h"
+#include "actuation.h"
+#ifdef WITH_VIDEO_CLIP
+#include "video_clip.h"
+#endif
 
 /* The structure which contains navdata  */
 static union navdata_t data;
@@ -20,6 +25,7 @@ static pthread_mutex_t mutex_stopped = PTHREAD_MUTEX_INITIALIZER;
 struct sockaddr_in addr_drone_navdata, addr_client_navdata;
 int sock_navdata;
 
+
 /**
   * \brief Receive the navdata from the drone and write it in NAVDATA_CHANNEL.
   * \return the result of recvfrom
@@ -29,25 +35,33 @@ int recv_cmd()
 	pthread_mutex_lock(&mutex_navdata);
 	socklen_t len = sizeof(addr_drone_navdata);
 	int ret = recvfrom(sock_navdata, &data, sizeof(data), 0, (struct sockaddr*)&addr_drone_navdata, &len);
-	size_t offset = 0;
+	jakopter_navdata_snapshot_t* snapshot = NULL;
+	double now = -1;
+
+	if (ret > 0) {
+		now = jakopter_clock_host_now();
+		clock_sync_add_sample(data.raw.sequence * CLOCK_SYNC_NAVDATA_PERIOD, now);
+#ifdef WITH_VIDEO_CLIP
+		video_clip_navdata_state(data.raw.ardrone_state);
+#endif
+	}
 
 	switch (data.demo.tag) {
 		case TAG_DEMO:
-			jakopter_com_write_int(nav_channel, offset, data.demo.vbat_flying_percentage);
-			offset += sizeof(data.demo.vbat_flying_percentage);
-			jakopter_com_write_int(nav_channel, offset, data.demo.altitude);
-			offset += sizeof(data.demo.altitude);
-			jakopter_com_write_float(nav_channel, offset, data.demo.theta);
-			offset += sizeof(data.demo.theta);
-			jakopter_com_write_float(nav_channel, offset, data.demo.phi);
-			offset += sizeof(data.demo.phi);
-			jakopter_com_write_float(nav_channel, offset, data.demo.psi);
-			offset += sizeof(data.demo.psi);
-			jakopter_com_write_float(nav_channel, offset, data.demo.vx);
-			offset += sizeof(data.demo.vx);
-			jakopter_com_write_float(nav_channel, offset, data.demo.vy);
-			offset += sizeof(data.demo.vy);
-			jakopter_com_write_float(nav_channel, offset, data.demo.vz);
+			snapshot = jakopter_com_lock(nav_channel);
+			if (snapshot != NULL) {
+				snapshot->battery = data.demo.vbat_flying_percentage;
+				snapshot->altitude = data.demo.altitude;
+				snapshot->theta = data.demo.theta;
+				snapshot->phi = data.demo.phi;
+				snapshot->psi = data.demo.psi;
+				snapshot->vx = data.demo.vx;
+				snapshot->vy = data.demo.vy;
+				snapshot->vz = data.demo.vz;
+				jakopter_com_unlock(nav_channel, 1);
+			}
+			if (ret > 0)
+				actuation_add_navdata(now, data.demo.theta, data.demo.phi, data.demo.psi, data.demo.altitude);
 			break;
 		default:
 			break;
@@ -75,7 +89,6 @@ int navdata_init()
 		perror("[~][navdata] Can't send ping\n");
 		return -1;
 	}
-
 	if (select(sock_navdata+1, &fds, NULL, NULL, &timeout) <= 0) {
 		perror("[~][navdata] Ping ack not received\n");
 		return -1;
@@ -132,8 +145,8 @@ void* navdata_routine(void* args)
 
 		if (recv_cmd() < 0)
 			perror("[~][navdata] Failed to receive navdata");
-		usleep(NAVDATA_INTERVAL*1000);
 
+		//keep the stream alive
 		if (sendto(sock_navdata, "\x01", 1, 0, (struct sockaddr*)&addr_drone_navdata, sizeof(addr_drone_navdata)) < 0) {
 			perror("[~][navdata] Failed to send ping\n");
 			pthread_exit(NULL);
@@ -157,7 +170,7 @@ int navdata_connect()
 		return -1;
 
 	addr_drone_navdata.sin_family      = AF_INET;
-	addr_drone_navdata.sin_addr.s_addr = inet_addr(WIFI_ARDRONE_IP);
+	addr_drone_navdata.sin_addr.s_addr = inet_addr(jakopter_drone_ip());
 	addr_drone_navdata.sin_port        = htons(PORT_NAVDATA);
 
 	addr_client_navdata.sin_family      = AF_INET;
@@ -170,13 +183,16 @@ int navdata_connect()
 		fprintf(stderr, "[~][navdata] Can't establish socket \n");
 		return -1;
 	}
+	jakopter_reuse_port(sock_navdata);
 
 	if (bind(sock_navdata, (struct sockaddr*)&addr_client_navdata, sizeof(addr_client_navdata)) < 0) {
 		fprintf(stderr, "[~][navdata] Can't bind socket to port %d\n", PORT_NAVDATA);
 		return -1;
 	}
 
-	nav_channel = jakopter_com_add_channel(CHANNEL_NAVDATA, sizeof(data));
+	nav_channel = jakopter_com_add_channel(CHANNEL_NAVDATA, sizeof(jakopter_navdata_snapshot_t));
+	clock_sync_reset();
+	actuation_init();
 
 	if (navdata_init() < 0) {
 		perror("[~][navdata] Init sequence failed");
@@ -272,6 +288,7 @@ int navdata_disconnect()
 		ret = pthread_join(navdata_thread, NULL);
 
 		jakopter_com_remove_channel(CHANNEL_NAVDATA);
+		actuation_clean();
 
 		close(sock_navdata);
 	}
@@ -0,0 +1,615 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/*
+* Network impairment emulator.
+* A proxy that sits between the library and the drone (or a stand-in),
+* and degrades each of the drone's ports following a scenario file.
+* The library is pointed at it through the JAKOPTER_DRONE_IP variable.
+* Usage : netem [-l listen_ip] [-c client_ip] [-d drone_ip] [-s seed] scenario_file
+*/
+
+//address the library talks to. Another loopback address, so that it doesn't
+//clash with the library's own sockets, which are bound to the same ports.
+#define NETEM_LISTEN_IP "127.0.0.2"
+//address of the library, where the drone's packets are forwarded
+#define NETEM_CLIENT_IP "127.0.0.1"
+#define NETEM_DRONE_IP "192.168.1.1"
+
+#define NETEM_NB_PORTS 3
+#define NETEM_MAX_STEPS 256
+#define NETEM_LINE_SIZE 256
+#define NETEM_UDP_SIZE 65536
+#define NETEM_TCP_CHUNK 1460
+//packets waiting on a link at most, the following ones are dropped.
+//TCP isn't read anymore instead, so that the sender slows down.
+#define NETEM_QUEUE_LIMIT 1000
+//longest wait in poll, in ms
+#define NETEM_POLL_TIMEOUT 100
+
+static const int ports[NETEM_NB_PORTS] = {5554, 5555, 5556};
+static const char* port_names[NETEM_NB_PORTS] = {"navdata", "video", "command"};
+//index of the only TCP port, the others are UDP
+#define NETEM_VIDEO 1
+
+//up = from the library to the drone
+enum { DIR_UP, DIR_DOWN, NB_DIRS };
+static const char* dir_names[NB_DIRS] = {"up", "down"};
+
+/*
+* Impairments of a link, as given in the scenario file.
+* delay and jitter in ms, loss, reorder and duplicate in %, rate in kbit/s (0 = unlimited).
+* Loss, reordering and duplication only apply to the UDP ports.
+*/
+enum { P_DELAY, P_JITTER, P_LOSS, P_REORDER, P_DUPLICATE, P_RATE, NB_PARAMS };
+static const char* param_names[NB_PARAMS] = {"delay", "jitter", "loss", "reorder", "duplicate", "rate"};
+
+typedef struct netem_stats {
+	long received, sent, lost, overflow, duplicated, reordered;
+	long bytes;
+	//sum of the delays added to the sent packets, in ms
+	double delay_sum;
+} netem_stats_t;
+
+typedef struct netem_link {
+	double params[NB_PARAMS];
+	netem_stats_t stats;
+	//time at which the rate-limited link is free again
+	double free_at;
+	//release time of the last packet, to keep the order despite jitter
+	double last_release;
+	int queued;
+} netem_link_t;
+
+/*
+* Line of the scenario : at the given time (s since the start),
+* change the parameters of a port (-1 = all ports), or end the run.
+*/
+typedef struct netem_step {
+	double time;
+	int port;
+	int reset;
+	int end;
+	double params[NB_PARAMS];
+	//bit i set if params[i] is given
+	unsigned set;
+} netem_step_t;
+
+typedef struct netem_packet {
+	struct netem_packet* next;
+	double arrival, release;
+	int port, dir;
+	int fd;
+	int tcp;
+	struct sockaddr_in to;
+	int size;
+	uint8_t data[];
+} netem_packet_t;
+
+static netem_link_t links[NETEM_NB_PORTS][NB_DIRS];
+static netem_step_t steps[NETEM_MAX_STEPS];
+static int nb_steps = 0;
+//packets waiting for their release, earliest first
+static netem_packet_t* queue = NULL;
+
+//UDP sockets facing the library and the drone, for each port (-1 for the video)
+static int client_fd[NETEM_NB_PORTS], drone_fd[NETEM_NB_PORTS];
+//port the library sends from, where the drone's packets go back
+static int client_port[NETEM_NB_PORTS];
+//video : listening socket, and the current connection on each side
+static int video_listen_fd = -1, video_client_fd = -1, video_drone_fd = -1;
+static struct sockaddr_in listen_addr, client_addr, drone_addr;
+
+static volatile sig_atomic_t running = 1;
+
+
+static double now_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000.0 + now.tv_nsec/1000000.0;
+}
+
+static void stop_handler(int sig)
+{
+	running = 0;
+}
+
+static int port_index(const char* name)
+{
+	int i=0;
+	for(i=0 ; i<NETEM_NB_PORTS ; i++)
+		if(strcmp(name, port_names[i]) == 0 || atoi(name) == ports[i])
+			return i;
+	return -2;
+}
+
+/*
+* Read the scenario file. Each line is :
+*	time port|all [reset] [param=value ...]
+*	time end
+* \returns 0 on success, -1 on error.
+*/
+static int load_scenario(const char* path)
+{
+	char line[NETEM_LINE_SIZE];
+	int line_no = 0;
+	FILE* file = fopen(path, "r");
+	if(file == NULL) {
+		perror("[netem] Can't open the scenario");
+		return -1;
+	}
+	while(fgets(line, NETEM_LINE_SIZE, file) != NULL) {
+		line_no++;
+		char* comment = strchr(line, '#');
+		if(comment != NULL)
+			*comment = '\0';
+		char* token = strtok(line, " \t\r\n");
+		if(token == NULL)
+			continue;
+		if(nb_steps == NETEM_MAX_STEPS) {
+			fprintf(stderr, "[netem] too many steps, the scenario is cut at line %d\n", line_no);
+			break;
+		}
+
+		netem_step_t* step = &steps[nb_steps];
+		memset(step, 0, sizeof(netem_step_t));
+		step->time = atof(token);
+		if(nb_steps > 0 && step->time < steps[nb_steps-1].time) {
+			fprintf(stderr, "[netem] line %d : steps must be in chronological order\n", line_no);
+			fclose(file);
+			return -1;
+		}
+		token = strtok(NULL, " \t\r\n");
+		if(token == NULL) {
+			fprintf(stderr, "[netem] line %d : missing port\n", line_no);
+			fclose(file);
+			return -1;
+		}
+		if(strcmp(token, "end") == 0)
+			step->end = 1;
+		else if(strcmp(token, "all") == 0)
+			step->port = -1;
+		else if((step->port = port_index(token)) < -1) {
+			fprintf(stderr, "[netem] line %d : unknown port %s\n", line_no, token);
+			fclose(file);
+			return -1;
+		}
+
+		while((token = strtok(NULL, " \t\r\n")) != NULL) {
+			if(strcmp(token, "reset") == 0) {
+				step->reset = 1;
+				continue;
+			}
+			char* value = strchr(token, '=');
+			int i=0;
+			if(value != NULL) {
+				*value++ = '\0';
+				for(i=0 ; i<NB_PARAMS && strcmp(token, param_names[i]) != 0 ; i++);
+			}
+			if(value == NULL || i == NB_PARAMS) {
+				fprintf(stderr, "[netem] line %d : unknown parameter %s\n", line_no, token);
+				fclose(file);
+				return -1;
+			}
+			step->params[i] = atof(value);
+			step->set |= 1 << i;
+		}
+		nb_steps++;
+	}
+	fclose(file);
+	return 0;
+}
+
+static void apply_step(const netem_step_t* step)
+{
+	int i=0, j=0, k=0;
+	for(i=0 ; i<NETEM_NB_PORTS ; i++) {
+		if(step->port >= 0 && step->port != i)
+			continue;
+		for(j=0 ; j<NB_DIRS ; j++) {
+			if(step->reset)
+				memset(links[i][j].params, 0, sizeof(links[i][j].params));
+			for(k=0 ; k<NB_PARAMS ; k++)
+				if(step->set & (1 << k))
+					links[i][j].params[k] = step->params[k];
+		}
+	}
+}
+
+/*Print the statistics of the phase that has just ended, and reset them.*/
+static void print_stats(int phase, double from, double to)
+{
+	int i=0, j=0;
+	double length = (to - from)/1000;
+	printf("[netem] phase %d, %.1f s - %.1f s\n", phase, from/1000, to/1000);
+	printf("  %-8s %-4s %8s %8s %6s %6s %6s %6s %9s %9s\n",
+		"port", "dir", "received", "sent", "lost", "ovfl", "dup", "reord", "kbit/s", "delay ms");
+	for(i=0 ; i<NETEM_NB_PORTS ; i++)
+		for(j=0 ; j<NB_DIRS ; j++) {
+			netem_stats_t* s = &links[i][j].stats;
+			printf("  %-8s %-4s %8ld %8ld %6ld %6ld %6ld %6ld %9.1f %9.1f\n",
+				port_names[i], dir_names[j], s->received, s->sent, s->lost, s->overflow,
+				s->duplicated, s->reordered, length > 0 ? s->bytes*8/length/1000 : 0,
+				s->sent > 0 ? s->delay_sum/s->sent : 0);
+			memset(s, 0, sizeof(netem_stats_t));
+		}
+	fflush(stdout);
+}
+
+static void queue_insert(netem_packet_t* packet)
+{
+	netem_packet_t** it = &queue;
+	//after the packets with the same release time, to keep their order
+	while(*it != NULL && (*it)->release <= packet->release)
+		it = &(*it)->next;
+	packet->next = *it;
+	*it = packet;
+}
+
+/*Drop the packets waiting on the video connection, when it's closed.*/
+static void queue_drop_video()
+{
+	netem_packet_t** it = &queue;
+	while(*it != NULL) {
+		if((*it)->tcp) {
+			netem_packet_t* packet = *it;
+			*it = packet->next;
+			links[packet->port][packet->dir].queued--;
+			free(packet);
+		}
+		else
+			it = &(*it)->next;
+	}
+}
+
+static void close_video()
+{
+	if(video_client_fd >= 0)
+		close(video_client_fd);
+	if(video_drone_fd >= 0)
+		close(video_drone_fd);
+	video_client_fd = -1;
+	video_drone_fd = -1;
+	queue_drop_video();
+}
+
+/*
+* Apply the impairments of the link to a packet, and queue it for release.
+*/
+static void schedule(int port, int dir, int fd, const struct sockaddr_in* to, int tcp,
+	const uint8_t* data, int size, double now)
+{
+	netem_link_t* link = &links[port][dir];
+	const double* p = link->params;
+	int copies = 1, i=0;
+
+	link->stats.received++;
+	if(!tcp && drand48()*100 < p[P_LOSS]) {
+		link->stats.lost++;
+		return;
+	}
+	if(!tcp && drand48()*100 < p[P_DUPLICATE]) {
+		link->stats.duplicated++;
+		copies = 2;
+	}
+
+	for(i=0 ; i<copies ; i++) {
+		if(link->queued >= NETEM_QUEUE_LIMIT) {
+			link->stats.overflow++;
+			return;
+		}
+		netem_packet_t* packet = malloc(sizeof(netem_packet_t) + size);
+		if(packet == NULL) {
+			link->stats.overflow++;
+			return;
+		}
+		//bandwidth cap : the packet leaves once the previous ones have been transmitted
+		double departure = now;
+		if(p[P_RATE] > 0) {
+			departure = (link->free_at > now ? link->free_at : now) + size*8/p[P_RATE];
+			link->free_at = departure;
+		}
+		double release = departure + p[P_DELAY] + p[P_JITTER]*(2*drand48() - 1);
+		if(release < departure)
+			release = departure;
+		//a reordered packet skips the delay, and overtakes the ones in flight
+		if(!tcp && drand48()*100 < p[P_REORDER]) {
+			release = departure;
+			link->stats.reordered++;
+		}
+		else {
+			if(release < link->last_release)
+				release = link->last_release;
+			link->last_release = release;
+		}
+
+		packet->arrival = now;
+		packet->release = release;
+		packet->port = port;
+		packet->dir = dir;
+		packet->fd = fd;
+		packet->tcp = tcp;
+		if(to != NULL)
+			packet->to = *to;
+		packet->size = size;
+		memcpy(packet->data, data, size);
+		queue_insert(packet);
+		link->queued++;
+	}
+}
+
+static void release_packets(double now)
+{
+	while(queue != NULL && queue->release <= now) {
+		netem_packet_t* packet = queue;
+		netem_link_t* link = &links[packet->port][packet->dir];
+		queue = packet->next;
+		link->queued--;
+
+		int ret = 0, sent = 0;
+		if(packet->tcp)
+			while(sent < packet->size && ret >= 0) {
+				ret = send(packet->fd, packet->data + sent, packet->size - sent, MSG_NOSIGNAL);
+				if(ret > 0)
+					sent += ret;
+			}
+		else
+			ret = sendto(packet->fd, packet->data, packet->size, 0,
+				(struct sockaddr*)&packet->to, sizeof(packet->to));
+
+		if(ret < 0) {
+			perror("[netem] Failed to forward a packet");
+			if(packet->tcp) {
+				free(packet);
+				close_video();
+				continue;
+			}
+		}
+		else {
+			link->stats.sent++;
+			link->stats.bytes += packet->size;
+			link->stats.delay_sum += now - packet->arrival;
+		}
+		free(packet);
+	}
+}
+
+static int open_udp(const struct sockaddr_in* addr)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	int yes = 1;
+	if(fd < 0)
+		return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	if(bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int open_sockets()
+{
+	int i=0, yes = 1;
+	struct sockaddr_in any;
+	memset(&any, 0, sizeof(any));
+	any.sin_family = AF_INET;
+	any.sin_addr.s_addr = htonl(INADDR_ANY);
+	any.sin_port = 0;
+
+	for(i=0 ; i<NETEM_NB_PORTS ; i++) {
+		client_fd[i] = -1;
+		drone_fd[i] = -1;
+		client_port[i] = ports[i];
+		if(i == NETEM_VIDEO)
+			continue;
+		listen_addr.sin_port = htons(ports[i]);
+		client_fd[i] = open_udp(&listen_addr);
+		//the drone answers to whatever port its packets come from
+		drone_fd[i] = open_udp(&any);
+		if(client_fd[i] < 0 || drone_fd[i] < 0) {
+			fprintf(stderr, "[netem] Can't open the sockets of port %d\n", ports[i]);
+			return -1;
+		}
+	}
+
+	video_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	listen_addr.sin_port = htons(ports[NETEM_VIDEO]);
+	if(video_listen_fd >= 0)
+		setsockopt(video_listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	if(video_listen_fd < 0 || bind(video_listen_fd, (struct sockaddr*)&listen_addr, sizeof(listen_addr)) < 0
+		|| listen(video_listen_fd, 1) < 0) {
+		fprintf(stderr, "[netem] Can't listen on the video port\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*New video connection from the library : connect to the drone on its behalf.*/
+static void accept_video()
+{
+	int fd = accept(video_listen_fd, NULL, NULL);
+	if(fd < 0)
+		return;
+	close_video();
+	video_drone_fd = socket(AF_INET, SOCK_STREAM, 0);
+	drone_addr.sin_port = htons(ports[NETEM_VIDEO]);
+	if(video_drone_fd < 0 || connect(video_drone_fd, (struct sockaddr*)&drone_addr, sizeof(drone_addr)) < 0) {
+		perror("[netem] Can't connect to the drone's video");
+		close(fd);
+		close_video();
+		return;
+	}
+	video_client_fd = fd;
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "Usage : %s [-l listen_ip] [-c client_ip] [-d drone_ip] [-s seed] scenario_file\n", name);
+}
+
+int main(int argc, char** argv)
+{
+	const char* listen_ip = NETEM_LISTEN_IP;
+	const char* client_ip = NETEM_CLIENT_IP;
+	const char* drone_ip = NETEM_DRONE_IP;
+	long seed = 1;
+	int opt, i=0;
+
+	while((opt = getopt(argc, argv, "l:c:d:s:")) != -1) {
+		switch(opt) {
+			case 'l': listen_ip = optarg; break;
+			case 'c': client_ip = optarg; break;
+			case 'd': drone_ip = optarg; break;
+			case 's': seed = atol(optarg); break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if(load_scenario(argv[optind]) < 0)
+		return 1;
+	//the same seed gives the same losses, for comparable runs
+	srand48(seed);
+
+	memset(&listen_addr, 0, sizeof(listen_addr));
+	listen_addr.sin_family = AF_INET;
+	listen_addr.sin_addr.s_addr = inet_addr(listen_ip);
+	client_addr = listen_addr;
+	client_addr.sin_addr.s_addr = inet_addr(client_ip);
+	drone_addr = listen_addr;
+	drone_addr.sin_addr.s_addr = inet_addr(drone_ip);
+	if(open_sockets() < 0)
+		return 1;
+
+	signal(SIGINT, stop_handler);
+	signal(SIGTERM, stop_handler);
+	printf("[netem] %s <-> %s (library at %s), %d steps\n", listen_ip, drone_ip, client_ip, nb_steps);
+
+	double start = now_ms(), phase_start = 0;
+	int next_step = 0, phase = 0;
+	static uint8_t buffer[NETEM_UDP_SIZE];
+
+	while(running) {
+		double now = now_ms();
+		//scenario
+		while(next_step < nb_steps && now - start >= steps[next_step].time*1000) {
+			//the last phase is printed on exit
+			if(steps[next_step].end) {
+				running = 0;
+				break;
+			}
+			if(steps[next_step].time*1000 > phase_start) {
+				print_stats(phase++, phase_start, now - start);
+				phase_start = now - start;
+			}
+			apply_step(&steps[next_step++]);
+		}
+		if(!running)
+			break;
+		release_packets(now);
+
+		//wait for packets, or the next release/step
+		struct pollfd fds[2*NETEM_NB_PORTS + 3];
+		int nb_fds = 0;
+		for(i=0 ; i<NETEM_NB_PORTS ; i++)
+			if(i != NETEM_VIDEO) {
+				fds[nb_fds].fd = client_fd[i];
+				fds[nb_fds++].events = POLLIN;
+				fds[nb_fds].fd = drone_fd[i];
+				fds[nb_fds++].events = POLLIN;
+			}
+		fds[nb_fds].fd = video_listen_fd;
+		fds[nb_fds++].events = POLLIN;
+		fds[nb_fds].fd = video_client_fd;
+		fds[nb_fds++].events = POLLIN;
+		//stop reading the drone's video while the link is saturated
+		fds[nb_fds].fd = links[NETEM_VIDEO][DIR_DOWN].queued < NETEM_QUEUE_LIMIT ? video_drone_fd : -1;
+		fds[nb_fds++].events = POLLIN;
+
+		double wake = now + NETEM_POLL_TIMEOUT;
+		if(queue != NULL && queue->release < wake)
+			wake = queue->release;
+		if(next_step < nb_steps && start + steps[next_step].time*1000 < wake)
+			wake = start + steps[next_step].time*1000;
+		int timeout = wake > now ? (int)(wake - now) : 0;
+		if(poll(fds, nb_fds, timeout) < 0) {
+			if(errno != EINTR)
+				perror("[netem] poll");
+			continue;
+		}
+		now = now_ms();
+
+		nb_fds = 0;
+		for(i=0 ; i<NETEM_NB_PORTS ; i++) {
+			if(i == NETEM_VIDEO)
+				continue;
+			struct sockaddr_in from;
+			socklen_t len = sizeof(from);
+			if(fds[nb_fds++].revents & POLLIN) {
+				int size = recvfrom(client_fd[i], buffer, NETEM_UDP_SIZE, 0, (struct sockaddr*)&from, &len);
+				if(size >= 0) {
+					client_port[i] = ntohs(from.sin_port);
+					drone_addr.sin_port = htons(ports[i]);
+					schedule(i, DIR_UP, drone_fd[i], &drone_addr, 0, buffer, size, now);
+				}
+			}
+			if(fds[nb_fds++].revents & POLLIN) {
+				int size = recv(drone_fd[i], buffer, NETEM_UDP_SIZE, 0);
+				if(size >= 0) {
+					client_addr.sin_port = htons(client_port[i]);
+					schedule(i, DIR_DOWN, client_fd[i], &client_addr, 0, buffer, size, now);
+				}
+			}
+		}
+		if(fds[nb_fds++].revents & POLLIN)
+			accept_video();
+		else {
+			if(video_client_fd >= 0 && fds[nb_fds].revents & (POLLIN | POLLHUP)) {
+				int size = recv(video_client_fd, buffer, NETEM_TCP_CHUNK, 0);
+				if(size <= 0)
+					close_video();
+				else
+					schedule(NETEM_VIDEO, DIR_UP, video_drone_fd, NULL, 1, buffer, size, now);
+			}
+			if(video_drone_fd >= 0 && fds[nb_fds+1].revents & (POLLIN | POLLHUP)) {
+				int size = recv(video_drone_fd, buffer, NETEM_TCP_CHUNK, 0);
+				if(size <= 0)
+					close_video();
+				else
+					schedule(NETEM_VIDEO, DIR_DOWN, video_client_fd, NULL, 1, buffer, size, now);
+			}
+		}
+	}
+
+	print_stats(phase, phase_start, now_ms() - start);
+	close_video();
+	while(queue != NULL) {
+		netem_packet_t* next = queue->next;
+		free(queue);
+		queue = next;
+	}
+	for(i=0 ; i<NETEM_NB_PORTS ; i++) {
+		if(client_fd[i] >= 0)
+			close(client_fd[i]);
+		if(drone_fd[i] >= 0)
+			close(drone_fd[i]);
+	}
+	close(video_listen_fd);
+	return 0;
+}
@@ -0,0 +1,91 @@
+//for dladdr
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <libgen.h>
+#include <limits.h>
+#include "plugin.h"
+
+static const char* plugin_names[NB_PLUGINS] = {"video", "display", "lua"};
+static const char* plugin_symbols[NB_PLUGINS] = {PLUGIN_VIDEO_SYMBOL, PLUGIN_DISPLAY_SYMBOL, PLUGIN_LUA_SYMBOL};
+
+//table of each loaded module. Modules are never unloaded, their threads may still run.
+static const void* plugins[NB_PLUGINS];
+//set once loading a module has been attempted, so that a missing one costs a single try
+static int tried[NB_PLUGINS];
+static pthread_mutex_t mutex_plugins = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+* Open a module : first in the directory given by the environment,
+* then next to the core library, then in the loader's search path.
+*/
+static void* plugin_open(const char* filename)
+{
+	char path[PATH_MAX];
+	char core_path[PATH_MAX];
+	Dl_info info;
+	void* handle = NULL;
+
+	const char* dir = getenv(PLUGIN_DIR_ENV);
+	if (dir != NULL && dir[0] != '\0') {
+		snprintf(path, sizeof(path), "%s/%s", dir, filename);
+		if ((handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) != NULL)
+			return handle;
+		fprintf(stderr, "[~][plugin] %s\n", dlerror());
+	}
+
+	if (dladdr((void*)jakopter_plugin_get, &info) != 0 && info.dli_fname != NULL) {
+		//dirname may modify its argument
+		snprintf(core_path, sizeof(core_path), "%s", info.dli_fname);
+		snprintf(path, sizeof(path), "%s/%s", dirname(core_path), filename);
+		if ((handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) != NULL)
+			return handle;
+	}
+
+	return dlopen(filename, RTLD_NOW | RTLD_LOCAL);
+}
+
+static const void* plugin_load(int id)
+{
+	char filename[64];
+	snprintf(filename, sizeof(filename), PLUGIN_FILENAME_FORMAT, plugin_names[id]);
+
+	void* handle = plugin_open(filename);
+	if (handle == NULL) {
+		fprintf(stderr, "[~][plugin] %s module unavailable : %s\n", plugin_names[id], dlerror());
+		return NULL;
+	}
+	//every table starts with the version
+	const int* table = dlsym(handle, plugin_symbols[id]);
+	if (table == NULL || *table != JAKOPTER_PLUGIN_VERSION) {
+		fprintf(stderr, "[~][plugin] %s isn't a compatible %s module\n", filename, plugin_names[id]);
+		dlclose(handle);
+		return NULL;
+	}
+	return table;
+}
+
+const void* jakopter_plugin_get(int id)
+{
+	if (id < 0 || id >= NB_PLUGINS)
+		return NULL;
+
+	pthread_mutex_lock(&mutex_plugins);
+	if (!tried[id]) {
+		plugins[id] = plugin_load(id);
+		tried[id] = 1;
+	}
+	const void* table = plugins[id];
+	pthread_mutex_unlock(&mutex_plugins);
+	return table;
+}
+
+const void* jakopter_plugin_peek(int id)
+{
+	if (id < 0 || id >= NB_PLUGINS)
+		return NULL;
+
+	pthread_mutex_lock(&mutex_plugins);
+	const void* table = plugins[id];
+	pthread_mutex_unlock(&mutex_plugins);
+	return table;
+}
@@ -0,0 +1,186 @@
+#include "plugin.h"
+#include "video_keyboard.h"
+#include "video_quality.h"
+#include "video_clip.h"
+
+/*
+Core side of the modules' functions : each one loads its module if needed,
+and forwards the call to it. Hooks called by the core itself only forward
+if the module is already there.
+*/
+
+#ifdef WITH_VIDEO
+static const jakopter_video_plugin_t* video_plugin()
+{
+	return jakopter_plugin_get(PLUGIN_VIDEO);
+}
+
+static const jakopter_display_plugin_t* display_plugin()
+{
+	return jakopter_plugin_get(PLUGIN_DISPLAY);
+}
+
+int jakopter_init_video()
+{
+	const jakopter_video_plugin_t* video = video_plugin();
+	return video != NULL ? video->init_video() : -1;
+}
+
+int jakopter_stop_video()
+{
+	//nothing to stop if it's never been started
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	return video != NULL ? video->stop_video() : 0;
+}
+
+int jakopter_video_set_camera(int camera)
+{
+	const jakopter_video_plugin_t* video = video_plugin();
+	return video != NULL ? video->set_camera(camera) : -1;
+}
+
+double jakopter_video_get_switch_latency()
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	return video != NULL ? video->get_switch_latency() : -1;
+}
+
+int jakopter_video_lock_frame(jakopter_video_frame_t* view)
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	return video != NULL ? video->lock_frame(view) : -1;
+}
+
+void jakopter_video_unlock_frame()
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	if (video != NULL)
+		video->unlock_frame();
+}
+
+int jakopter_video_get_quality(jakopter_video_quality_t* quality)
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	return video != NULL ? video->get_quality(quality) : -1;
+}
+
+int jakopter_video_latency(double* last, double* mean, double* max)
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	return video != NULL ? video->latency(last, mean, max) : 0;
+}
+
+void jakopter_video_quality_filter(float min_sharpness, float max_clipped, float max_corruption)
+{
+	const jakopter_video_plugin_t* video = video_plugin();
+	if (video != NULL)
+		video->quality_filter(min_sharpness, max_clipped, max_corruption);
+}
+
+int video_display_frame(uint8_t* frame, int width, int height, int size)
+{
+	const jakopter_display_plugin_t* display = jakopter_plugin_peek(PLUGIN_DISPLAY);
+	return display != NULL ? display->frame(frame, width, height, size) : 0;
+}
+
+int jakopter_display_submit(int stream, uint8_t* frame, int width, int height, int size)
+{
+	const jakopter_display_plugin_t* display = jakopter_plugin_peek(PLUGIN_DISPLAY);
+	return display != NULL ? display->submit(stream, frame, width, height, size) : -1;
+}
+
+int jakopter_display_set_hud(int stream, const video_display_hud_t* hud)
+{
+	const jakopter_display_plugin_t* display = jakopter_plugin_peek(PLUGIN_DISPLAY);
+	return display != NULL ? display->set_hud(stream, hud) : -1;
+}
+
+int jakopter_display_remove_stream(int stream)
+{
+	const jakopter_display_plugin_t* display = jakopter_plugin_peek(PLUGIN_DISPLAY);
+	return display != NULL ? display->remove_stream(stream) : -1;
+}
+
+int jakopter_display_set_layout(int layout)
+{
+	const jakopter_display_plugin_t* display = jakopter_plugin_peek(PLUGIN_DISPLAY);
+	return display != NULL ? display->set_layout(layout) : -1;
+}
+
+int video_display_init()
+{
+	const jakopter_display_plugin_t* display = display_plugin();
+	return display != NULL ? display->init() : -1;
+}
+
+void video_display_clean()
+{
+	const jakopter_display_plugin_t* display = jakopter_plugin_peek(PLUGIN_DISPLAY);
+	if (display != NULL)
+		display->clean();
+}
+
+void jakopter_keyboard_enable(int enabled)
+{
+	const jakopter_display_plugin_t* display = display_plugin();
+	if (display != NULL)
+		display->keyboard_enable(enabled);
+}
+
+void jakopter_keyboard_set_ramp(float max_speed, float accel)
+{
+	const jakopter_display_plugin_t* display = display_plugin();
+	if (display != NULL)
+		display->keyboard_set_ramp(max_speed, accel);
+}
+#endif
+
+#ifdef WITH_VIDEO_OFFLINE
+int jakopter_video_process_file(const char* path, int nb_workers, video_offline_callback callback,
+	size_t result_size, void** results, void* user)
+{
+	const jakopter_video_plugin_t* video = video_plugin();
+	if (video == NULL || video->process_file == NULL)
+		return -1;
+	return video->process_file(path, nb_workers, callback, result_size, results, user);
+}
+#endif
+
+#ifdef WITH_VIDEO_CLIP
+int jakopter_video_clip(double before, double after)
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	if (video == NULL || video->clip == NULL)
+		return -1;
+	return video->clip(before, after);
+}
+
+void jakopter_video_clip_on_state(uint32_t mask)
+{
+	const jakopter_video_plugin_t* video = video_plugin();
+	if (video != NULL && video->clip_on_state != NULL)
+		video->clip_on_state(mask);
+}
+
+void video_clip_navdata_state(uint32_t state)
+{
+	const jakopter_video_plugin_t* video = jakopter_plugin_peek(PLUGIN_VIDEO);
+	if (video != NULL && video->clip_navdata_state != NULL)
+		video->clip_navdata_state(state);
+}
+#endif
+
+#ifdef WITH_LUA
+/**
+* Entry point of require("libjakopter"). The bindings themselves are in the Lua module.
+*/
+int luaopen_libjakopter(void* L)
+{
+	const jakopter_lua_plugin_t* lua = jakopter_plugin_get(PLUGIN_LUA);
+	if (lua == NULL) {
+		fprintf(stderr, "[plugin] Error : the Lua bindings can't be loaded\n");
+		return 0;
+	}
+	return lua->open(L);
+}
+#endif
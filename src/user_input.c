@@ -49,8 +49,8 @@ void* user_input_routine(void* args)
 
 		if ((param1 != pparam1) || (pparam2 != param2)) {
 			// write only when you have a new value
-			jakopter_com_write_int(user_input_channel,0, (int) param1);
-			jakopter_com_write_int(user_input_channel,4, (int) param2);
+			jakopter_user_input_t input = {param1, param2};
+			jakopter_com_write_buf(user_input_channel, 0, &input, sizeof(input));
 			pparam1 = param1;
 			pparam2 = param2;
 		}
@@ -72,10 +72,9 @@ int user_input_connect()
 
 	printf("[user_input] connecting user input\n");
 
-	// right now it is just 2 int
-	user_input_channel = jakopter_com_add_channel(CHANNEL_USERINPUT, 2*sizeof(int));
-	jakopter_com_write_int(user_input_channel, 0, 0);
-	jakopter_com_write_int(user_input_channel, 4, 0);
+	jakopter_user_input_t input = {0, 0};
+	user_input_channel = jakopter_com_add_channel(CHANNEL_USERINPUT, sizeof(input));
+	jakopter_com_write_buf(user_input_channel, 0, &input, sizeof(input));
 	
 	printf("[user_input] channel created\n");
 
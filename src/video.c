@@ -2,6 +2,13 @@
 #include "video_queue.h"
 #include "video_decode.h"
 #include "video_display.h"
+#include "video_quality.h"
+#include "drone.h"
+#include "clock_sync.h"
+#ifdef WITH_VIDEO_CLIP
+#include "video_clip.h"
+#endif
+#include <time.h>
 
 
 //addresses for video communication
@@ -41,11 +48,86 @@ static volatile int terminated = 1;
 static pthread_mutex_t mutex_terminated = PTHREAD_MUTEX_INITIALIZER;
 
 
+/*Copy of the last processed frame, handed out to the user by jakopter_video_lock_frame.
+It's only maintained once someone has asked for it, to avoid an useless copy per frame.*/
+static jakopter_video_frame_t frame_view = {0, 0, 0, NULL};
+//allocated size of frame_view.pixels
+static size_t frame_view_capacity = 0;
+//number of frames copied to the view so far
+static int frame_view_count = 0;
+static volatile int frame_view_wanted = 0;
+static pthread_mutex_t mutex_frame_view = PTHREAD_MUTEX_INITIALIZER;
+//set in the thread that holds the view, so that locking it twice fails instead of deadlocking
+static __thread int frame_view_held = 0;
+
+/*Metrics of the last processed frame, and number of frames dropped by the quality filter.
+last_quality.valid is 0 until a frame has been processed.*/
+static jakopter_video_quality_t last_quality;
+static int quality_dropped = 0;
+static pthread_mutex_t mutex_quality = PTHREAD_MUTEX_INITIALIZER;
+
+//reception to end of processing latency of the frames, in ms
+static double latency_last = -1, latency_sum = 0, latency_max = 0;
+static int latency_count = 0;
+static pthread_mutex_t mutex_latency = PTHREAD_MUTEX_INITIALIZER;
+
+/*Camera switch requested by the user, to be handled by the video thread. -1 = none.*/
+static int camera_request = -1;
+//time at which the last switch was requested
+static struct timespec switch_start;
+//set by the video thread while waiting for the first frame of the new camera
+static int switch_in_progress = 0;
+//latency of the last completed switch in ms, -1 if none.
+static double switch_latency = -1;
+static pthread_mutex_t mutex_camera = PTHREAD_MUTEX_INITIALIZER;
+//size of the video produced by each camera, see jakopter_camera
+static const int camera_sizes[JAKO_NB_CAMERAS][2] = {
+	{JAKO_CAMERA_FRONT_W, JAKO_CAMERA_FRONT_H},
+	{JAKO_CAMERA_BOTTOM_W, JAKO_CAMERA_BOTTOM_H}
+};
+
 //clean things that have been initiated/created by init_video and need manual cleaning.
 static void video_clean();
 int video_join_thread();
 
 
+//milliseconds elapsed since the given time
+static double elapsed_ms(const struct timespec* since)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec)*1000. + (now.tv_nsec - since->tv_nsec)/1000000.;
+}
+
+/*Handle the camera switch requested by the user, if any :
+flush the decoder for the new camera and drop the frame waiting to be processed.
+Then, keep track of the switch until the first frame of the new camera comes in.*/
+static void video_handle_camera_switch(int got_frame)
+{
+	pthread_mutex_lock(&mutex_camera);
+	if(camera_request >= 0) {
+		if(video_decode_flush(camera_sizes[camera_request][0], camera_sizes[camera_request][1]) < 0) {
+			fprintf(stderr, "Video : failed to flush the decoder for the camera switch.\n");
+			video_set_stopped();
+		}
+		video_queue_flush();
+		camera_request = -1;
+		switch_in_progress = 1;
+	}
+	else if(switch_in_progress) {
+		double latency = elapsed_ms(&switch_start);
+		if(got_frame == 1) {
+			switch_latency = latency;
+			switch_in_progress = 0;
+			printf("Video : switched camera in %.1f ms\n", latency);
+		}
+		//the size we expected may not be the one the drone actually sends
+		else if(latency > VIDEO_SWITCH_TIMEOUT)
+			video_decode_accept_any_keyframe();
+	}
+	pthread_mutex_unlock(&mutex_camera);
+}
+
 void* video_routine(void* args)
 {
 	//TCP segment of encoded video received from the drone
@@ -69,6 +151,7 @@ void* video_routine(void* args)
 			/*receive the video data from the drone. Only BASE_SIZE, since
 			TCP_SIZE may be larger on purpose.*/
 			pack_size = recv(sock_video, tcp_buf, BASE_VIDEO_BUF_SIZE, 0);
+			double received = jakopter_clock_host_now();
 			if(pack_size == 0) {
 				printf("Stream ended by server. Ending the video thread.\n");
 				video_set_stopped();
@@ -83,14 +166,18 @@ void* video_routine(void* args)
 					video_set_stopped();
 				}
 				//if we have a complete decoded frame, push it onto the queue for decoding
-				else if(got_frame == 1)
+				else if(got_frame == 1) {
+					decoded_frame.received = received;
 					video_queue_push_frame(&decoded_frame);
+				}
 			}
 		}
 		else {
 			printf("Video : data reception has timed out. Ending the video thread now.\n");
 			video_set_stopped();
 		}
+		video_handle_camera_switch(got_frame);
+		got_frame = 0;
 		//reset the timeout and the FDSET entry
 		video_timeout.tv_sec = VIDEO_TIMEOUT;
 		FD_ZERO(&vid_fd_set);
@@ -108,10 +195,40 @@ void* video_routine(void* args)
 	pthread_exit(NULL);
 }
 
+/*Copy the given frame to the user-visible view.
+If the view is currently locked by the user, skip this frame rather than blocking the thread.*/
+static void video_update_frame_view(const jakopter_video_frame_t* frame)
+{
+	if(!frame_view_wanted || pthread_mutex_trylock(&mutex_frame_view) != 0)
+		return;
+
+	if(frame->size > frame_view_capacity) {
+		uint8_t* pixels = realloc(frame_view.pixels, frame->size);
+		if(pixels == NULL) {
+			fprintf(stderr, "[Video Processing] Couldn't allocate memory for the frame view\n");
+			pthread_mutex_unlock(&mutex_frame_view);
+			return;
+		}
+		frame_view.pixels = pixels;
+		frame_view_capacity = frame->size;
+	}
+	memcpy(frame_view.pixels, frame->pixels, frame->size);
+	frame_view.w = frame->w;
+	frame_view.h = frame->h;
+	frame_view.size = frame->size;
+	frame_view.quality = frame->quality;
+	frame_view_count++;
+
+	pthread_mutex_unlock(&mutex_frame_view);
+}
+
 void* processing_routine(void* args)
 {
 	//decoded video frame that will be pulled from the queue
 	jakopter_video_frame_t frame;
+	//half resolution luma for the quality metrics
+	uint8_t* scratch = NULL;
+	size_t scratch_size = 0;
 	//wait for frames to be decoded, and then process them.
 	pthread_mutex_lock(&mutex_stopped);
 	while(!stopped) {
@@ -121,14 +238,35 @@ void* processing_routine(void* args)
 			video_set_stopped();
 		}
 		//a 0-sized frame means we're about to quit.
-		else if(frame.size != 0)
-			if(frame_processing_callback(frame.pixels, frame.w, frame.h, frame.size) < 0) {
+		else if(frame.size != 0) {
+			//score the frame, and drop it here if it doesn't pass the quality filter
+			video_quality_compute(&frame, &scratch, &scratch_size);
+			int passed = video_quality_check(&frame.quality);
+			pthread_mutex_lock(&mutex_quality);
+			last_quality = frame.quality;
+			quality_dropped += !passed;
+			pthread_mutex_unlock(&mutex_quality);
+
+			if(passed && frame_processing_callback(frame.pixels, frame.w, frame.h, frame.size) < 0) {
 				fprintf(stderr, "[Video Processing] Error processing frame !\n");
 				video_set_stopped();
 			}
+			if(passed)
+				video_update_frame_view(&frame);
+			if(passed && frame.received >= 0) {
+				pthread_mutex_lock(&mutex_latency);
+				latency_last = jakopter_clock_host_now() - frame.received;
+				latency_sum += latency_last;
+				if(latency_last > latency_max)
+					latency_max = latency_last;
+				latency_count++;
+				pthread_mutex_unlock(&mutex_latency);
+			}
+		}
 		pthread_mutex_lock(&mutex_stopped);
 	}
 	pthread_mutex_unlock(&mutex_stopped);
+	free(scratch);
 	//free the resources of the processing module
 	if(frame_processing_clean != NULL)
 		frame_processing_clean();
@@ -146,9 +284,19 @@ int jakopter_init_video()
 	}
 	//make sure the thread is terminated
 	video_join_thread();
+
+	pthread_mutex_lock(&mutex_camera);
+	camera_request = -1;
+	switch_in_progress = 0;
+	pthread_mutex_unlock(&mutex_camera);
+
+	pthread_mutex_lock(&mutex_quality);
+	memset(&last_quality, 0, sizeof(last_quality));
+	quality_dropped = 0;
+	pthread_mutex_unlock(&mutex_quality);
 	
 	addr_drone_video.sin_family      = AF_INET;
-	addr_drone_video.sin_addr.s_addr = inet_addr(WIFI_ARDRONE_IP);
+	addr_drone_video.sin_addr.s_addr = inet_addr(jakopter_drone_ip());
 	addr_drone_video.sin_port        = htons(PORT_VIDEO);
 	
 	//initialize the fdset
@@ -160,11 +308,19 @@ int jakopter_init_video()
 		pthread_mutex_unlock(&mutex_stopped);
 		return -1;
 	}
+#ifdef WITH_VIDEO_CLIP
+	//clips are optional, the video can go on without them
+	if(video_clip_init() < 0)
+		fprintf(stderr, "Video : couldn't start clip capture.\n");
+#endif
 
 	sock_video = socket(AF_INET, SOCK_STREAM, 0);
 	if(sock_video < 0) {
 		fprintf(stderr, "Error : couldn't bind TCP socket.\n");
 		video_stop_decoder();
+#ifdef WITH_VIDEO_CLIP
+		video_clip_clean();
+#endif
 		pthread_mutex_unlock(&mutex_stopped);
 		return -1;
 	}
@@ -216,6 +372,16 @@ void video_clean()
 		perror("Error stopping video connection");
 	video_stop_decoder();
 	video_queue_free();
+#ifdef WITH_VIDEO_CLIP
+	video_clip_clean();
+#endif
+
+	pthread_mutex_lock(&mutex_frame_view);
+	free(frame_view.pixels);
+	frame_view = VIDEO_QUEUE_END;
+	frame_view_capacity = 0;
+	frame_view_count = 0;
+	pthread_mutex_unlock(&mutex_frame_view);
 }
 
 /*Ask the video thread to stop without joining with it.
@@ -275,3 +441,77 @@ int video_join_thread()
 	return prev_state;
 }
 
+int jakopter_video_set_camera(int camera)
+{
+	if(camera < 0 || camera >= JAKO_NB_CAMERAS) {
+		fprintf(stderr, "Video : invalid camera %d\n", camera);
+		return -1;
+	}
+	/*let the video thread flush the decoder right away :
+	any frame coming in from now on may belong to either camera.*/
+	pthread_mutex_lock(&mutex_camera);
+	clock_gettime(CLOCK_MONOTONIC, &switch_start);
+	camera_request = camera;
+	pthread_mutex_unlock(&mutex_camera);
+
+	char value[SIZE_INT];
+	snprintf(value, SIZE_INT, "%d", camera);
+	return jakopter_config("video:video_channel", value);
+}
+
+double jakopter_video_get_switch_latency()
+{
+	pthread_mutex_lock(&mutex_camera);
+	double latency = switch_latency;
+	pthread_mutex_unlock(&mutex_camera);
+	return latency;
+}
+
+int jakopter_video_lock_frame(jakopter_video_frame_t* view)
+{
+	if(frame_view_held) {
+		fprintf(stderr, "[Video Processing] The frame view is already locked by this thread\n");
+		return -1;
+	}
+	frame_view_wanted = 1;
+	pthread_mutex_lock(&mutex_frame_view);
+	if(frame_view.pixels == NULL) {
+		pthread_mutex_unlock(&mutex_frame_view);
+		return -1;
+	}
+	*view = frame_view;
+	frame_view_held = 1;
+	return frame_view_count;
+}
+
+void jakopter_video_unlock_frame()
+{
+	if(!frame_view_held)
+		return;
+	frame_view_held = 0;
+	pthread_mutex_unlock(&mutex_frame_view);
+}
+
+int jakopter_video_latency(double* last, double* mean, double* max)
+{
+	pthread_mutex_lock(&mutex_latency);
+	int count = latency_count;
+	if(last != NULL)
+		*last = latency_last;
+	if(mean != NULL)
+		*mean = count > 0 ? latency_sum / count : -1;
+	if(max != NULL)
+		*max = latency_max;
+	pthread_mutex_unlock(&mutex_latency);
+	return count;
+}
+
+int jakopter_video_get_quality(jakopter_video_quality_t* quality)
+{
+	pthread_mutex_lock(&mutex_quality);
+	int dropped = last_quality.valid ? quality_dropped : -1;
+	if(quality != NULL)
+		*quality = last_quality;
+	pthread_mutex_unlock(&mutex_quality);
+	return dropped;
+}
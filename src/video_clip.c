@@ -0,0 +1,371 @@
+#include <libavformat/avformat.h>
+#include <time.h>
+#include "video_clip.h"
+#include "clock_sync.h"
+
+//the writer thread wakes up at least this often (ms) to copy the new frames of a clip
+#define CLIP_COPY_INTERVAL 1000
+
+/**
+* Compressed frame, in the rolling buffer or in a clip being written.
+*/
+typedef struct clip_packet {
+	struct clip_packet* next;
+	//increases with each frame, to find out where the previous copy stopped
+	uint64_t number;
+	//host reception time in ms
+	double time;
+	int key;
+	int size;
+	uint8_t data[];
+} clip_packet_t;
+
+/**
+* Singly linked list of frames, with a pointer to its end for appending.
+*/
+typedef struct clip_list {
+	clip_packet_t* head;
+	clip_packet_t* tail;
+} clip_list_t;
+
+//the rolling buffer, oldest frame first. Always starts with a keyframe.
+static clip_list_t buffer = {NULL, NULL};
+static size_t buffer_bytes = 0;
+static uint64_t next_number = 0;
+
+//set while a clip is waiting for its end or being written
+static int clip_pending = 0;
+//time range of the pending clip, in host ms
+static double clip_start = 0, clip_end = 0;
+//wall clock time of the trigger, for the file name
+static time_t clip_trigger;
+
+//navdata state bits that trigger a clip, and their previous values
+static uint32_t state_mask = 0;
+static uint32_t last_state = 0;
+
+static pthread_t clip_thread;
+static int clip_stopped = 1;
+//protects everything above, and signals triggers and stops to the writer
+static pthread_mutex_t mutex_clip = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_clip = PTHREAD_COND_INITIALIZER;
+
+
+static void clip_list_append(clip_list_t* list, clip_packet_t* packet)
+{
+	packet->next = NULL;
+	if(list->tail == NULL)
+		list->head = packet;
+	else
+		list->tail->next = packet;
+	list->tail = packet;
+}
+
+static void clip_list_free(clip_list_t* list)
+{
+	while(list->head != NULL) {
+		clip_packet_t* next = list->head->next;
+		free(list->head);
+		list->head = next;
+	}
+	list->tail = NULL;
+}
+
+/*Remove the oldest keyframe of the buffer and the frames depending on it.*/
+static void clip_drop_oldest_gop()
+{
+	do {
+		clip_packet_t* head = buffer.head;
+		buffer.head = head->next;
+		buffer_bytes -= head->size;
+		free(head);
+	} while(buffer.head != NULL && !buffer.head->key);
+	if(buffer.head == NULL)
+		buffer.tail = NULL;
+}
+
+/*
+* Copy the frames of the pending clip that haven't been copied yet.
+* The first copy starts at the last keyframe before the start of the clip.
+* Must be called with mutex_clip locked.
+* \param last number of the last frame copied. Updated.
+* \param started 0 before the first frame has been copied. Updated.
+*/
+static void clip_copy(clip_list_t* clip, uint64_t* last, int* started)
+{
+	clip_packet_t* packet = buffer.head;
+	if(!*started) {
+		clip_packet_t* it;
+		for(it = buffer.head ; it != NULL && it->time <= clip_start ; it = it->next)
+			if(it->key)
+				packet = it;
+	}
+	else {
+		if(packet != NULL && packet->number > *last+1)
+			fprintf(stderr, "[~][clip] buffer overrun, %d frames missing in the clip\n",
+				(int)(packet->number - *last - 1));
+		while(packet != NULL && packet->number <= *last)
+			packet = packet->next;
+		//can't go on after a gap without a keyframe
+		while(packet != NULL && packet->number > *last+1 && !packet->key)
+			packet = packet->next;
+	}
+
+	for( ; packet != NULL && packet->time <= clip_end ; packet = packet->next) {
+		clip_packet_t* copy = malloc(sizeof(clip_packet_t) + packet->size);
+		if(copy == NULL) {
+			fprintf(stderr, "[~][clip] couldn't allocate memory for the clip\n");
+			return;
+		}
+		memcpy(copy, packet, sizeof(clip_packet_t) + packet->size);
+		clip_list_append(clip, copy);
+		*last = packet->number;
+		*started = 1;
+	}
+}
+
+/*Write the frames to a MPEG-TS file, timestamped with their reception time.*/
+static int clip_write(const char* filename, const clip_list_t* clip)
+{
+	AVFormatContext* format = NULL;
+	AVRational ms_base = {1, 1000};
+
+	if(clip->head == NULL) {
+		fprintf(stderr, "[~][clip] no video to write to %s\n", filename);
+		return -1;
+	}
+	if(avformat_alloc_output_context2(&format, NULL, "mpegts", filename) < 0) {
+		fprintf(stderr, "[~][clip] couldn't create the muxer\n");
+		return -1;
+	}
+	AVStream* stream = avformat_new_stream(format, NULL);
+	if(stream == NULL) {
+		avformat_free_context(format);
+		return -1;
+	}
+	stream->codec->codec_type = AVMEDIA_TYPE_VIDEO;
+	stream->codec->codec_id = AV_CODEC_ID_H264;
+	stream->time_base = ms_base;
+
+	if(avio_open(&format->pb, filename, AVIO_FLAG_WRITE) < 0) {
+		fprintf(stderr, "[~][clip] couldn't open %s\n", filename);
+		avformat_free_context(format);
+		return -1;
+	}
+	if(avformat_write_header(format, NULL) < 0) {
+		fprintf(stderr, "[~][clip] couldn't write the header of %s\n", filename);
+		avio_close(format->pb);
+		avformat_free_context(format);
+		return -1;
+	}
+
+	int nb_frames = 0;
+	int64_t last_dts = -1;
+	const clip_packet_t* packet;
+	for(packet = clip->head ; packet != NULL ; packet = packet->next) {
+		AVPacket av_packet;
+		av_init_packet(&av_packet);
+		av_packet.data = (uint8_t*)packet->data;
+		av_packet.size = packet->size;
+		av_packet.stream_index = stream->index;
+		if(packet->key)
+			av_packet.flags |= AV_PKT_FLAG_KEY;
+		//the muxer needs strictly increasing timestamps
+		int64_t dts = av_rescale_q(packet->time - clip->head->time, ms_base, stream->time_base);
+		if(dts <= last_dts)
+			dts = last_dts+1;
+		av_packet.pts = av_packet.dts = last_dts = dts;
+		if(av_write_frame(format, &av_packet) < 0)
+			fprintf(stderr, "[~][clip] couldn't write frame %d\n", nb_frames);
+		else
+			nb_frames++;
+	}
+	av_write_trailer(format);
+	avio_close(format->pb);
+	avformat_free_context(format);
+
+	printf("[clip] %d frames (%.1f s) written to %s\n", nb_frames,
+		(clip->tail->time - clip->head->time)/1000, filename);
+	return 0;
+}
+
+/*File name of the pending clip, from the time of its trigger.
+Clips triggered during the same second get a number. Must be called with mutex_clip locked.*/
+static void clip_filename(char* filename, size_t size)
+{
+	static char last_name[64] = "";
+	static int same_name = 0;
+	struct tm trigger;
+	char name[64];
+	localtime_r(&clip_trigger, &trigger);
+	strftime(name, sizeof(name), CLIP_FILENAME_FORMAT, &trigger);
+	if(strcmp(name, last_name) != 0) {
+		strcpy(last_name, name);
+		same_name = 0;
+		snprintf(filename, size, "%s", name);
+		return;
+	}
+	//insert the number before the extension
+	same_name++;
+	char* extension = strrchr(name, '.');
+	int base = extension != NULL ? extension - name : (int)strlen(name);
+	snprintf(filename, size, "%.*s_%d%s", base, name, same_name, extension != NULL ? extension : "");
+}
+
+void* clip_routine(void* args)
+{
+	pthread_mutex_lock(&mutex_clip);
+	while(1) {
+		while(!clip_stopped && !clip_pending)
+			pthread_cond_wait(&cond_clip, &mutex_clip);
+		if(!clip_pending)
+			break;
+
+		clip_list_t clip = {NULL, NULL};
+		uint64_t last = 0;
+		int started = 0;
+		char filename[64];
+		clip_filename(filename, sizeof(filename));
+
+		//copy regularly, so that long clips aren't overwritten by the rolling buffer
+		clip_copy(&clip, &last, &started);
+		double now = jakopter_clock_host_now();
+		while(!clip_stopped && now < clip_end) {
+			double wait = clip_end - now < CLIP_COPY_INTERVAL ? clip_end - now : CLIP_COPY_INTERVAL;
+			struct timeval tv;
+			gettimeofday(&tv, NULL);
+			long nsec = tv.tv_usec*1000 + (long)(wait*1000000);
+			struct timespec deadline = {tv.tv_sec + nsec/1000000000, nsec%1000000000};
+			pthread_cond_timedwait(&cond_clip, &mutex_clip, &deadline);
+			clip_copy(&clip, &last, &started);
+			now = jakopter_clock_host_now();
+		}
+		/*The clip is complete : a trigger coming in while it's written
+		starts the next one, which is handled once this one is done.*/
+		clip_pending = 0;
+		pthread_mutex_unlock(&mutex_clip);
+
+		clip_write(filename, &clip);
+		clip_list_free(&clip);
+
+		pthread_mutex_lock(&mutex_clip);
+	}
+	pthread_mutex_unlock(&mutex_clip);
+	pthread_exit(NULL);
+}
+
+int video_clip_init()
+{
+	av_register_all();
+
+	pthread_mutex_lock(&mutex_clip);
+	if(!clip_stopped) {
+		pthread_mutex_unlock(&mutex_clip);
+		return -1;
+	}
+	clip_list_free(&buffer);
+	buffer_bytes = 0;
+	clip_pending = 0;
+	last_state = 0;
+	clip_stopped = 0;
+	if(pthread_create(&clip_thread, NULL, clip_routine, NULL) < 0) {
+		perror("[~][clip] Can't create the writer thread");
+		clip_stopped = 1;
+		pthread_mutex_unlock(&mutex_clip);
+		return -1;
+	}
+	pthread_mutex_unlock(&mutex_clip);
+	return 0;
+}
+
+void video_clip_clean()
+{
+	pthread_mutex_lock(&mutex_clip);
+	if(!clip_stopped) {
+		clip_stopped = 1;
+		pthread_cond_broadcast(&cond_clip);
+		pthread_mutex_unlock(&mutex_clip);
+		pthread_join(clip_thread, NULL);
+		pthread_mutex_lock(&mutex_clip);
+	}
+	clip_list_free(&buffer);
+	buffer_bytes = 0;
+	pthread_mutex_unlock(&mutex_clip);
+}
+
+void video_clip_push(const uint8_t* data, int size, int key)
+{
+	if(size <= 0 || size > CLIP_BUFFER_SIZE)
+		return;
+
+	pthread_mutex_lock(&mutex_clip);
+	while(buffer.head != NULL && buffer_bytes + size > CLIP_BUFFER_SIZE)
+		clip_drop_oldest_gop();
+	//frames that come before the first keyframe can't be decoded
+	if(clip_stopped || (buffer.head == NULL && !key)) {
+		pthread_mutex_unlock(&mutex_clip);
+		return;
+	}
+	clip_packet_t* packet = malloc(sizeof(clip_packet_t) + size);
+	if(packet == NULL) {
+		pthread_mutex_unlock(&mutex_clip);
+		return;
+	}
+	packet->number = ++next_number;
+	packet->time = jakopter_clock_host_now();
+	packet->key = key;
+	packet->size = size;
+	memcpy(packet->data, data, size);
+	clip_list_append(&buffer, packet);
+	buffer_bytes += size;
+	pthread_mutex_unlock(&mutex_clip);
+}
+
+/*Start or extend a clip. Must be called with mutex_clip locked.*/
+static int clip_trigger_locked(double before, double after)
+{
+	if(clip_stopped)
+		return -1;
+	double now = jakopter_clock_host_now();
+	if(clip_pending) {
+		if(now + after*1000 > clip_end)
+			clip_end = now + after*1000;
+	}
+	else {
+		clip_start = now - before*1000;
+		clip_end = now + after*1000;
+		clip_trigger = time(NULL);
+		clip_pending = 1;
+	}
+	pthread_cond_broadcast(&cond_clip);
+	return 0;
+}
+
+void video_clip_navdata_state(uint32_t state)
+{
+	pthread_mutex_lock(&mutex_clip);
+	uint32_t raised = state & ~last_state & state_mask;
+	last_state = state;
+	if(raised && clip_trigger_locked(CLIP_DEFAULT_BEFORE, CLIP_DEFAULT_AFTER) == 0)
+		printf("[clip] navdata state 0x%x raised, saving a clip\n", raised);
+	pthread_mutex_unlock(&mutex_clip);
+}
+
+int jakopter_video_clip(double before, double after)
+{
+	if(before < 0 || after < 0)
+		return -1;
+	pthread_mutex_lock(&mutex_clip);
+	int ret = clip_trigger_locked(before, after);
+	pthread_mutex_unlock(&mutex_clip);
+	if(ret < 0)
+		fprintf(stderr, "[~][clip] the video isn't running\n");
+	return ret;
+}
+
+void jakopter_video_clip_on_state(uint32_t mask)
+{
+	pthread_mutex_lock(&mutex_clip);
+	state_mask = mask;
+	pthread_mutex_unlock(&mutex_clip);
+}
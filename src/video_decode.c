@@ -1,4 +1,7 @@
 #include "video_decode.h"
+#ifdef WITH_VIDEO_CLIP
+#include "video_clip.h"
+#endif
 
 
 static AVCodec* codec;
@@ -13,6 +16,12 @@ static int tempBufferSize = 0;
 static unsigned char* tempBuffer = NULL;
 //current video size. Used to check whether the size has changed, and tempBuffer reallocation is needed.
 static int current_width = 0, current_height = 0;
+//set after a flush : decoded frames are dropped until a keyframe comes in.
+static int wait_keyframe = 0;
+//size of the keyframe we're waiting for. 0 = any size.
+static int expected_width = 0, expected_height = 0;
+//set when a frame couldn't be decoded : the next ones may be damaged, until a keyframe comes in.
+static int damaged = 0;
 
 /*Load up the h264 codec needed for video decoding.
 Perform the initialization steps required by FFmpeg.*/
@@ -50,26 +59,77 @@ int video_init_decoder() {
 	tempBuffer = NULL;
 	current_width = 0;
 	current_height = 0;
+	wait_keyframe = 0;
+	damaged = 0;
 	return 0;
 }
 
 /*
-* Allocate tempBuffer so that it can hold a decoded YUV420p frame of the
-* size currently specified in the current_frame structure.
+* Allocate tempBuffer so that it can hold a decoded YUV420p frame of the given size.
 * Update current_width/height and tempBufferSize to match these new dimensions.
 */
-static int video_alloc_frame_buffer() {
+static int video_alloc_frame_buffer(int width, int height) {
 	if(tempBuffer != NULL)
 		free(tempBuffer);
-	tempBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, current_frame->width, current_frame->height);
+	tempBufferSize = avpicture_get_size(AV_PIX_FMT_YUV420P, width, height);
 	tempBuffer = calloc(tempBufferSize, 1);
-	if(tempBuffer == NULL)
+	if(tempBuffer == NULL) {
+		tempBufferSize = 0;
+		current_width = 0;
+		current_height = 0;
 		return -1;
-	current_width = current_frame->width;
-	current_height = current_frame->height;
+	}
+	current_width = width;
+	current_height = height;
 	return 0;
 }
 
+int video_decode_flush(int width, int height) {
+	//restart the parser from scratch, so that it doesn't glue old data to the new stream
+	av_parser_close(cpContext);
+	cpContext = av_parser_init(AV_CODEC_ID_H264);
+	if(cpContext == NULL) {
+		fprintf(stderr, "FFmpeg error : couldn't reinitialize the frame parser.\n");
+		return -1;
+	}
+	//drop the reference frames of the previous stream
+	avcodec_flush_buffers(context);
+	av_init_packet(&video_packet);
+	frameOffset = 0;
+
+	wait_keyframe = 1;
+	damaged = 0;
+	expected_width = width > 0 ? width : 0;
+	expected_height = height > 0 ? height : 0;
+	//allocate now rather than when the first frame comes in
+	if(width > 0 && height > 0 && (width != current_width || height != current_height))
+		if(video_alloc_frame_buffer(width, height) < 0) {
+			fprintf(stderr, "Error : couldn't allocate memory for decoding.\n");
+			return -1;
+		}
+	return 0;
+}
+
+void video_decode_accept_any_keyframe() {
+	expected_width = 0;
+	expected_height = 0;
+}
+
+/*
+* Check whether the frame that has just been decoded is one we're waiting for
+* after a flush, and stop waiting if it is.
+*/
+static int video_frame_is_expected() {
+	if(!wait_keyframe)
+		return 1;
+	if(!current_frame->key_frame)
+		return 0;
+	if(expected_width > 0 && (current_frame->width != expected_width || current_frame->height != expected_height))
+		return 0;
+	wait_keyframe = 0;
+	return 1;
+}
+
 /*
 Decode a video buffer.
 Returns:
@@ -101,18 +161,26 @@ int video_decode_packet(uint8_t* buffer, int buf_size, jakopter_video_frame_t* r
 		
 		//3. do we have a frame to decode ?
 		if(video_packet.size > 0) {
+#ifdef WITH_VIDEO_CLIP
+			//keep the compressed frame, in case a clip is asked for
+			video_clip_push(video_packet.data, video_packet.size, cpContext->key_frame == 1);
+#endif
 			//printf("Packet size : %d\n", video_packet.size);
 			decodedLen = avcodec_decode_video2(context, current_frame, &complete_frame, &video_packet);
 			if(decodedLen < 0) {
 				fprintf(stderr, "Error : couldn't decode frame.\n");
+				damaged = 1;
 				return 0;
 			}
+			//frames from before a flush are garbage, drop them.
+			if(complete_frame && !video_frame_is_expected())
+				av_frame_unref(current_frame);
 			//If we get there, we should've decoded a frame.
-			if(complete_frame) {
+			else if(complete_frame) {
 				nb_frames++;
 				//check if the video size has changed
 				if(current_frame->width != current_width || current_frame->height != current_height)
-					if(video_alloc_frame_buffer() < 0) {
+					if(video_alloc_frame_buffer(current_frame->width, current_frame->height) < 0) {
 						fprintf(stderr, "Error : couldn't allocate memory for decoding.\n");
 						return -1;
 					}
@@ -124,6 +192,10 @@ int video_decode_packet(uint8_t* buffer, int buf_size, jakopter_video_frame_t* r
 				result->w = current_frame->width;
 				result->h = current_frame->height;
 				result->size = picsize;
+				memset(&result->quality, 0, sizeof(result->quality));
+				if(current_frame->key_frame)
+					damaged = 0;
+				result->quality.decode_error = damaged;
 
 				//printf("Decoded frame : %d bytes, format : %d, size : %dx%d\n", picsize, current_frame->format, current_frame->width, current_frame->height);
 				//free the frame's references for reuse
@@ -4,11 +4,22 @@
 #include "navdata.h"
 #include "video_display.h"
 #include "com_master.h"
+#include "com_layouts.h"
+#include "video_keyboard.h"
+#include "clock_sync.h"
 
 //maximum size in bytes of a text to be displayed
 #define TEXT_BUF_SIZE 100
 #define PI 3.14159265
+//size of the window until the first frame tells us the size of the video
+#define DEFAULT_WIN_W 640
+#define DEFAULT_WIN_H 360
+//in PIP layout, thumbnails are this many times smaller than the window
+#define PIP_SCALE 4
+#define PIP_MARGIN 8
 
+//update_infos reads the whole layout at once, it would fail on a smaller channel
+COM_LAYOUT_ASSERT(DISPLAY_COM_IN_SIZE >= sizeof(jakopter_display_infos_t), "display : DISPLAY_COM_IN_SIZE too small");
 
 /**
 * Structure that defines a graphical element that can be drawn on the screen.
@@ -17,47 +28,69 @@ typedef struct graphics {
 	SDL_Texture* tex;
 	SDL_Rect pos;
 } graphics_t;
-/*
-* List of all overlayed graphical elements. For now, navdata text only.
+
+/**
+* A video stream shown in the window.
+* The first group of fields is written by the threads submitting frames
+* and read by the render thread, always under mutex_tiles.
+* The second group belongs to the render thread.
 */
-graphics_t graphs[VIDEO_NB_NAV_INFOS];
+typedef struct display_tile {
+	//is this stream currently shown ?
+	int active;
+	//last submitted frame, waiting to be uploaded to the texture
+	uint8_t* pixels;
+	size_t capacity;
+	int w, h, size;
+	int new_frame;
+	//last submitted flight informations
+	video_display_hud_t hud;
+	int new_hud;
+
+	//streaming texture holding the frame, and its size
+	SDL_Texture* tex;
+	int tex_w, tex_h;
+	//where the tile is drawn in the window
+	SDL_Rect rect;
+	//HUD currently drawn, and its text elements
+	video_display_hud_t shown_hud;
+	graphics_t graphs[VIDEO_NB_NAV_INFOS];
+} display_tile_t;
+
+static display_tile_t tiles[DISPLAY_MAX_STREAMS];
+static pthread_mutex_t mutex_tiles = PTHREAD_MUTEX_INITIALIZER;
+static enum video_display_layout layout = DISPLAY_LAYOUT_GRID;
+//set when the tiles need to be placed again in the window
+static int layout_changed = 0;
+//set when the window should be resized to fit the streams (new stream, size change...)
+static int size_changed = 0;
+
 /*
 * channels for data input and output.
 * Input expects navdata in the following order :
 * battery%, altitude, angles (3), speed (3)
+* It is shown on stream 0.
 */
 static jakopter_com_channel_t *com_in;
 /*
-* The SDL window where the video is displayed.
+* The SDL window where the videos are displayed.
 */
 static SDL_Window* win = NULL;
 /*
-* SDL renderer attached to our window
+* SDL renderer attached to our window, shared by all the streams.
 */
 static SDL_Renderer* renderer = NULL;
+//does the renderer wait for the vertical refresh by itself ?
+static int has_vsync = 0;
 /*
-* Texture that holds the current frame to display. It's the same size as the window.
-*/
-static SDL_Texture* frameTex = NULL;
-/*
-* Current size of the window and the frame texture.
-* Mainly used to check whether it's changed.
-*/
-static int current_width=0, current_height=0;
-/*
-* Default size to use when the module is initialized without specifying it.
+* The render thread owns all SDL resources. It uploads the frames that have been
+* submitted since the last refresh, and presents the result once per refresh.
 */
-//static int default_w=640, default_h=480;
-/*
-* Current pitch, roll, yaw and speed (unused for now) of the plane.
-* These are kept updated via the input com channel.
-*/
-static float pitch=0, roll=0, yaw=0;
-static float speed=0;
-/*
-* Check whether or not the display has been initialized.
-*/
-static int initialized = 0;
+static pthread_t render_thread;
+static volatile int render_stopped = 1;
+static pthread_mutex_t mutex_render_stopped = PTHREAD_MUTEX_INITIALIZER;
+//Set by the render thread if it couldn't initialize SDL.
+static volatile int render_error = 0;
 /**
 * TTF-related functions (for text)
 */
@@ -69,8 +102,6 @@ static SDL_Texture* video_make_text(char* text, int* res_w, int* res_h);
 
 //Last saved modification timestamp from the input channel
 static double prev_update = 0;
-//Set to 1 if the user wants to capture a screenshot; then set back to 0 automatically
-static int want_screenshot = 0;
 //Total number of screenshots taken, used for screenshot filenames
 static int screenshot_nb = 0;
 //Base screenshot name. Final name = base name + screenshot_nb
@@ -80,31 +111,32 @@ static char* screenshot_baseName = "screen_";
 */
 static void take_screenshot(uint8_t* frame, int size);
 /*
-* Read the input channel to update the displayed informations.
+* Read the input channel to update the informations of stream 0.
+* Returns 1 if the channel has changed.
 */
-static void update_infos();
+static int update_infos();
+/*
+* Re-create the text elements of a tile if its HUD has changed.
+*/
+static void update_hud_text(display_tile_t* tile);
 
 ///////Horizon indicator overlay options////////
-//Position on the screen
-int horiz_posx, horiz_posy;
-//length of the horizon
-int horiz_size;
+//length of the horizon, for a 640 pixels wide tile
+int horiz_size = 200;
 //scale of the pitch indicator in pixels/degrees
 float horiz_pitchScale = 1;
 //Draw the drone's attitude indicator
-static void draw_attitude_indic();
+static void draw_attitude_indic(const display_tile_t* tile);
 ////////////////////////////////////////////////
 //////////Compass overlay options///////////////
-//position of the compass
-int compass_x = 0, compass_y = 0;
-//width and height of the compass in pixels
+//width and height of the compass in pixels, for a 640 pixels wide tile
 int compass_w = 200, compass_h = 50;
 //number of vertical bars visible on the compass
 int compass_nbBars = 8;
 //scale of the compass in piels/degrees (how fast the compass spins)
 int compass_scale = 1;
 //Draw the drone's compass
-static void draw_compass();
+static void draw_compass(const display_tile_t* tile);
 ////////////////////////////////////////////////
 /*
 * Simple point rotation function. Angle in degrees.
@@ -114,41 +146,35 @@ static void rotate_point(SDL_Point* point, const SDL_Point* center, float angle)
 /**
 * Initialize SDL, create the window and the renderer
 * to get ready to draw frames.
-* @param w
-* @param h width and height with which to create the window.
+* Called from the render thread.
 * @return 0 on success, -1 on error.
 */
-static int video_display_init_size(int width, int height) {
+static int video_display_init_sdl() {
 
 	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
 		fprintf(stderr, "Display : error initializing SDL : %s\n", SDL_GetError());
 		return -1;
 	}
-	//create a window of the given size, without options. Make it centered.
+	//create a resizable window, its size will be adjusted to the streams. Make it centered.
 	win = SDL_CreateWindow("Drone video",
-		SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED,width,height,0);
+		SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED,DEFAULT_WIN_W,DEFAULT_WIN_H,SDL_WINDOW_RESIZABLE);
 	if(win == NULL) {
 		fprintf(stderr, "Display : error creating window : %s\n", SDL_GetError());
 		return -1;
 	}
 
-	renderer = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED);
+	renderer = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 	if(renderer == NULL) {
 		fprintf(stderr, "Display : error creating renderer : %s\n", SDL_GetError());
 		return -1;
 	}
-
-	//set the overlay elements to null so that they don't get drawn
-	int i=0;
-	for(i=0 ; i<VIDEO_NB_NAV_INFOS ; i++)
-		graphs[i].tex = NULL;
+	SDL_RendererInfo info;
+	has_vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
 
 	//initialize SDL_ttf for font rendering
 	if(video_init_text(FONT_PATH) == -1)
 		return -1;
 
-	pitch=0;
-	roll=0;
 	SDL_SetRenderDrawColor(renderer, 0, 250, 0, 255);
 
 	return 0;
@@ -169,71 +195,342 @@ static int video_init_text(char* font_path)
 }
 
 /**
-* Set the size of the window and of the texture containing the video.
-* The parameters become the current size.
+* Free everything the render thread has created.
 */
-static int video_display_set_size(int w, int h) {
-	SDL_SetWindowSize(win, w, h);
-	//re-create the texture, with the new size
-	SDL_DestroyTexture(frameTex);
-	frameTex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, w, h);
-	if(frameTex == NULL) {
-		fprintf(stderr, "Display : failed to create frame texture : %s\n", SDL_GetError());
-		return -1;
+static void video_display_clean_sdl() {
+	int i=0, j=0;
+	for(i=0 ; i<DISPLAY_MAX_STREAMS ; i++) {
+		if(tiles[i].tex != NULL)
+			SDL_DestroyTexture(tiles[i].tex);
+		tiles[i].tex = NULL;
+		for(j=0 ; j<VIDEO_NB_NAV_INFOS ; j++) {
+			if(tiles[i].graphs[j].tex != NULL)
+				SDL_DestroyTexture(tiles[i].graphs[j].tex);
+			tiles[i].graphs[j].tex = NULL;
+		}
 	}
-	current_width = w;
-	current_height = h;
-	//recalculate the attitude indicator's and the compass' position
-	horiz_size = 200;
-	horiz_posx = w/2 - horiz_size/2;
-	horiz_posy = h - horiz_pitchScale*180;
-	compass_x = horiz_posx;
-	compass_y = h - compass_h*1.5;
-	return 0;
+	if(renderer != NULL)
+		SDL_DestroyRenderer(renderer);
+	if(win != NULL)
+		SDL_DestroyWindow(win);
+	renderer = NULL;
+	win = NULL;
+	if(font != NULL)
+		video_clean_text();
+	SDL_Quit();
+}
+
+static void video_clean_text()
+{
+	TTF_CloseFont(font);
+	font = NULL;
+	TTF_Quit();
+}
+
+/**
+* Place a tile in the given cell, keeping the aspect ratio of its video.
+*/
+static void fit_tile(display_tile_t* tile, int x, int y, int w, int h) {
+	if(tile->w * h > tile->h * w) {
+		tile->rect.w = w;
+		tile->rect.h = w * tile->h / tile->w;
+	}
+	else {
+		tile->rect.h = h;
+		tile->rect.w = h * tile->w / tile->h;
+	}
+	tile->rect.x = x + (w - tile->rect.w)/2;
+	tile->rect.y = y + (h - tile->rect.h)/2;
+}
+
+/**
+* Compute the position of every active tile in the window.
+* If resize is set, first adjust the window so that the streams
+* are shown at their native size. Called with mutex_tiles held.
+*/
+static void video_display_layout(int resize) {
+	int ids[DISPLAY_MAX_STREAMS];
+	int nb = 0, i = 0;
+	for(i=0 ; i<DISPLAY_MAX_STREAMS ; i++)
+		if(tiles[i].active)
+			ids[nb++] = i;
+	if(nb == 0)
+		return;
+
+	int cols = 1, rows = 1;
+	if(layout == DISPLAY_LAYOUT_GRID) {
+		while(cols*cols < nb)
+			cols++;
+		rows = (nb + cols - 1) / cols;
+	}
+	//the first stream gives the size of a cell
+	if(resize)
+		SDL_SetWindowSize(win, cols * tiles[ids[0]].w, rows * tiles[ids[0]].h);
+
+	int win_w, win_h;
+	SDL_GetWindowSize(win, &win_w, &win_h);
+
+	if(layout == DISPLAY_LAYOUT_PIP) {
+		fit_tile(&tiles[ids[0]], 0, 0, win_w, win_h);
+		//thumbnails go along the bottom of the window, from right to left
+		int thumb_w = win_w / PIP_SCALE, thumb_h = win_h / PIP_SCALE;
+		for(i=1 ; i<nb ; i++)
+			fit_tile(&tiles[ids[i]], win_w - i*(thumb_w + PIP_MARGIN),
+				win_h - thumb_h - PIP_MARGIN, thumb_w, thumb_h);
+	}
+	else {
+		int cell_w = win_w / cols, cell_h = win_h / rows;
+		for(i=0 ; i<nb ; i++)
+			fit_tile(&tiles[ids[i]], (i % cols)*cell_w, (i / cols)*cell_h, cell_w, cell_h);
+	}
+}
+
+/**
+* Upload the frames submitted since the last refresh into their textures.
+* \returns 1 if something has to be redrawn, 0 if not, -1 on error.
+*/
+static int video_display_upload() {
+	int changed = 0, i = 0;
+	pthread_mutex_lock(&mutex_tiles);
+	if(layout_changed || size_changed) {
+		video_display_layout(size_changed);
+		layout_changed = 0;
+		size_changed = 0;
+		changed = 1;
+	}
+	for(i=0 ; i<DISPLAY_MAX_STREAMS ; i++) {
+		display_tile_t* tile = &tiles[i];
+		if(!tile->active)
+			continue;
+		if(tile->new_hud) {
+			tile->shown_hud = tile->hud;
+			tile->new_hud = 0;
+			update_hud_text(tile);
+			changed = 1;
+		}
+		if(!tile->new_frame)
+			continue;
+		//re-create the texture if the size of the video has changed
+		if(tile->tex == NULL || tile->w != tile->tex_w || tile->h != tile->tex_h) {
+			if(tile->tex != NULL)
+				SDL_DestroyTexture(tile->tex);
+			tile->tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, tile->w, tile->h);
+			if(tile->tex == NULL) {
+				fprintf(stderr, "Display : failed to create frame texture : %s\n", SDL_GetError());
+				pthread_mutex_unlock(&mutex_tiles);
+				return -1;
+			}
+			tile->tex_w = tile->w;
+			tile->tex_h = tile->h;
+		}
+		if(SDL_UpdateTexture(tile->tex, NULL, tile->pixels, tile->w) < 0) {
+			fprintf(stderr, "Display : failed to update frame texture : %s\n", SDL_GetError());
+			pthread_mutex_unlock(&mutex_tiles);
+			return -1;
+		}
+		tile->new_frame = 0;
+		changed = 1;
+	}
+	pthread_mutex_unlock(&mutex_tiles);
+	return changed;
+}
+
+/**
+* Draw every active stream and its HUD.
+*/
+static void video_display_render() {
+	int i=0, j=0;
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	SDL_RenderClear(renderer);
+	SDL_SetRenderDrawColor(renderer, 0, 250, 0, 255);
+	for(i=0 ; i<DISPLAY_MAX_STREAMS ; i++) {
+		display_tile_t* tile = &tiles[i];
+		if(!tile->active || tile->tex == NULL)
+			continue;
+		SDL_RenderCopy(renderer, tile->tex, NULL, &tile->rect);
+		//keep the overlay inside the tile
+		SDL_RenderSetClipRect(renderer, &tile->rect);
+		//draw all overlay elements, when they exist
+		for(j=0 ; j<VIDEO_NB_NAV_INFOS ; j++)
+			if(tile->graphs[j].tex != NULL) {
+				SDL_Rect pos = tile->graphs[j].pos;
+				pos.x += tile->rect.x;
+				pos.y += tile->rect.y;
+				SDL_RenderCopy(renderer, tile->graphs[j].tex, NULL, &pos);
+			}
+		draw_attitude_indic(tile);
+		draw_compass(tile);
+		SDL_RenderSetClipRect(renderer, NULL);
+	}
+}
+
+/**
+* Process the pending window and keyboard events.
+* \returns 1 if the window needs to be redrawn.
+*/
+static int video_display_events() {
+	SDL_Event event;
+	int changed = 0;
+	while(SDL_PollEvent(&event)) {
+		if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+			//the event may have waited in the queue, date it back to when it happened
+			double time = jakopter_clock_host_now() - (SDL_GetTicks() - event.key.timestamp);
+			video_keyboard_key(event.key.keysym.scancode, event.type == SDL_KEYDOWN, event.key.repeat, time);
+			continue;
+		}
+		if(event.type != SDL_WINDOWEVENT)
+			continue;
+		switch(event.window.event) {
+			//the key releases would go to another window
+			case SDL_WINDOWEVENT_FOCUS_LOST:
+				video_keyboard_release_all();
+				break;
+			case SDL_WINDOWEVENT_SIZE_CHANGED:
+				pthread_mutex_lock(&mutex_tiles);
+				layout_changed = 1;
+				pthread_mutex_unlock(&mutex_tiles);
+				changed = 1;
+				break;
+			case SDL_WINDOWEVENT_EXPOSED:
+				changed = 1;
+				break;
+			default:
+				break;
+		}
+	}
+	return changed;
 }
 
+/**
+* Render thread : owns the window, uploads the new frames
+* and presents them at most once per screen refresh.
+*/
+static void* render_routine(void* args)
+{
+	if(video_display_init_sdl() < 0) {
+		fprintf(stderr, "Display : Failed initialization.\n");
+		video_display_clean_sdl();
+		render_error = 1;
+		pthread_exit(NULL);
+	}
+	//without vsync, pace the presentation ourselves
+	SDL_DisplayMode mode;
+	int refresh_rate = DISPLAY_DEFAULT_REFRESH;
+	if(SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(win), &mode) == 0 && mode.refresh_rate > 0)
+		refresh_rate = mode.refresh_rate;
+	Uint32 refresh_ms = 1000 / refresh_rate;
+	Uint32 last_present = SDL_GetTicks();
+
+	pthread_mutex_lock(&mutex_render_stopped);
+	while(!render_stopped) {
+		pthread_mutex_unlock(&mutex_render_stopped);
+
+		int changed = video_display_events();
+		//write the keyboard setpoint before anything slow
+		int ramping = video_keyboard_update();
+		changed |= update_infos();
+		int uploaded = video_display_upload();
+		if(uploaded < 0) {
+			render_error = 1;
+			pthread_mutex_lock(&mutex_render_stopped);
+			break;
+		}
+		changed |= uploaded;
+
+		Uint32 elapsed = SDL_GetTicks() - last_present;
+		//idle : sleep, but wake up as soon as a key is pressed. Ramps need regular updates.
+		if(!changed && !ramping)
+			SDL_WaitEventTimeout(NULL, refresh_ms);
+		else if(!changed)
+			SDL_Delay(refresh_ms);
+		else {
+			if(!has_vsync && elapsed < refresh_ms)
+				SDL_Delay(refresh_ms - elapsed);
+			video_display_render();
+			//with vsync, this waits for the next refresh
+			SDL_RenderPresent(renderer);
+			last_present = SDL_GetTicks();
+		}
+
+		pthread_mutex_lock(&mutex_render_stopped);
+	}
+	pthread_mutex_unlock(&mutex_render_stopped);
+
+	video_display_clean_sdl();
+	pthread_exit(NULL);
+}
 
 int video_display_init()
 {
+	int i=0;
+	pthread_mutex_lock(&mutex_render_stopped);
+	if(!render_stopped) {
+		pthread_mutex_unlock(&mutex_render_stopped);
+		fprintf(stderr, "Display : already running.\n");
+		return -1;
+	}
+
 	com_in = jakopter_com_add_channel(CHANNEL_DISPLAY, DISPLAY_COM_IN_SIZE);
 	if(com_in == NULL) {
+		pthread_mutex_unlock(&mutex_render_stopped);
 		fprintf(stderr, "Display : couldn't create com channel.\n");
 		return -1;
 	}
 	prev_update = 0;
+	render_error = 0;
+
+	pthread_mutex_lock(&mutex_tiles);
+	//frames may have been submitted since the last clean
+	for(i=0 ; i<DISPLAY_MAX_STREAMS ; i++)
+		free(tiles[i].pixels);
+	memset(tiles, 0, sizeof(tiles));
+	layout_changed = 0;
+	size_changed = 0;
+	pthread_mutex_unlock(&mutex_tiles);
+
+	render_stopped = 0;
+	if(pthread_create(&render_thread, NULL, render_routine, NULL) < 0) {
+		perror("Display : can't create the render thread");
+		render_stopped = 1;
+		pthread_mutex_unlock(&mutex_render_stopped);
+		jakopter_com_remove_channel(CHANNEL_DISPLAY);
+		return -1;
+	}
+	pthread_mutex_unlock(&mutex_render_stopped);
 
 	return 0;
 }
 
 /**
-* Clean the display context : close the window and clean SDL structures.
+* Clean the display context : stop the render thread, which closes the window
+* and cleans SDL structures.
 */
 void video_display_clean() {
 	int i=0;
+	pthread_mutex_lock(&mutex_render_stopped);
 	//no need to clean stuff if it hasn't been initialized.
-	if(initialized) {
-		SDL_DestroyTexture(frameTex);
-		for(i=0 ; i<VIDEO_NB_NAV_INFOS ; i++)
-			if(graphs[i].tex != NULL)
-				SDL_DestroyTexture(graphs[i].tex);
-		SDL_DestroyRenderer(renderer);
-		SDL_DestroyWindow(win);
-		video_clean_text();
-		SDL_Quit();
-		jakopter_com_remove_channel(CHANNEL_DISPLAY);
-		initialized = 0;
+	if(render_stopped) {
+		pthread_mutex_unlock(&mutex_render_stopped);
+		return;
 	}
-}
-
-static void video_clean_text()
-{
-	TTF_CloseFont(font);
-	TTF_Quit();
+	render_stopped = 1;
+	pthread_mutex_unlock(&mutex_render_stopped);
+	pthread_join(render_thread, NULL);
+
+	pthread_mutex_lock(&mutex_tiles);
+	for(i=0 ; i<DISPLAY_MAX_STREAMS ; i++) {
+		free(tiles[i].pixels);
+		tiles[i].pixels = NULL;
+		tiles[i].capacity = 0;
+		tiles[i].active = 0;
+	}
+	pthread_mutex_unlock(&mutex_tiles);
+	jakopter_com_remove_channel(CHANNEL_DISPLAY);
 }
 
 /**
 * "Got frame" callback.
-* Fills the texture with the given frame, and displays it on the window.
+* Hands the frame over to the render thread as stream 0.
 */
 int video_display_frame(uint8_t* frame, int width, int height, int size) {
 
@@ -242,55 +539,74 @@ int video_display_frame(uint8_t* frame, int width, int height, int size) {
 		video_display_clean();
 		return 0;
 	}
+	//the window couldn't be created, no need to go on.
+	if(render_error)
+		return -1;
 
-	//first time called ? Initialize things.
-	if(!initialized) {
-		if(video_display_init_size(width, height) < 0) {
-			fprintf(stderr, "Display : Failed initialization.\n");
-			return -1;
-		}
-		if(video_display_set_size(width, height) < 0)
-			return -1;
+	return video_display_submit(0, frame, width, height, size);
+}
 
-		initialized = 1;
+int video_display_submit(int stream, uint8_t* frame, int width, int height, int size) {
+	//the texture is uploaded as a whole YUV420p frame, whatever the size given
+	if(stream < 0 || stream >= DISPLAY_MAX_STREAMS || frame == NULL || width <= 0 || height <= 0
+		|| size <= 0 || size < width*height*3/2) {
+		fprintf(stderr, "Display : invalid frame submitted for stream %d\n", stream);
+		return -1;
 	}
 
-	//check whether the size of the video has changed
-	if(width != current_width || height != current_height)
-		if(video_display_set_size(width, height) < 0)
+	display_tile_t* tile = &tiles[stream];
+	pthread_mutex_lock(&mutex_tiles);
+	if((size_t)size > tile->capacity) {
+		uint8_t* pixels = realloc(tile->pixels, size);
+		if(pixels == NULL) {
+			pthread_mutex_unlock(&mutex_tiles);
+			fprintf(stderr, "Display : couldn't allocate memory for stream %d\n", stream);
 			return -1;
-
-	//check whether there's new stuff in the input com buffer
-	double new_update = jakopter_com_get_timestamp(com_in);
-	if(new_update > prev_update) {
-		update_infos();
-		if(want_screenshot) {
-			take_screenshot(frame, size);
-			want_screenshot = 0;
-			jakopter_com_write_int(com_in, 24, 0);
 		}
-		prev_update = new_update;
+		tile->pixels = pixels;
+		tile->capacity = size;
 	}
+	memcpy(tile->pixels, frame, size);
+	//a new stream or a size change : the window has to be rearranged
+	if(!tile->active || width != tile->w || height != tile->h)
+		size_changed = 1;
+	tile->active = 1;
+	tile->w = width;
+	tile->h = height;
+	tile->size = size;
+	tile->new_frame = 1;
+	pthread_mutex_unlock(&mutex_tiles);
 
-	//update the texture with our new frame
-	if(SDL_UpdateTexture(frameTex, NULL, frame, width) < 0) {
-		fprintf(stderr, "Display : failed to update frame texture : %s\n", SDL_GetError());
+	return 0;
+}
+
+int video_display_set_hud(int stream, const video_display_hud_t* hud) {
+	if(stream < 0 || stream >= DISPLAY_MAX_STREAMS || hud == NULL)
 		return -1;
-	}
+	pthread_mutex_lock(&mutex_tiles);
+	tiles[stream].hud = *hud;
+	tiles[stream].new_hud = 1;
+	pthread_mutex_unlock(&mutex_tiles);
+	return 0;
+}
 
-	//clear the renderer, then update it so that we get the new frame displayed.
-	SDL_RenderClear(renderer);
-	SDL_RenderCopy(renderer, frameTex, NULL, NULL);
-	//SDL_RenderFillRect(renderer, &rectangle);
-	//draw all overlay elements, when they exist
-	int i=0;
-	for(i=0 ; i<VIDEO_NB_NAV_INFOS ; i++)
-		if(graphs[i].tex != NULL)
-			SDL_RenderCopy(renderer, graphs[i].tex, NULL, &graphs[i].pos);
-	draw_attitude_indic();
-	draw_compass();
-	SDL_RenderPresent(renderer);
+int video_display_remove_stream(int stream) {
+	if(stream < 0 || stream >= DISPLAY_MAX_STREAMS)
+		return -1;
+	pthread_mutex_lock(&mutex_tiles);
+	tiles[stream].active = 0;
+	size_changed = 1;
+	pthread_mutex_unlock(&mutex_tiles);
+	return 0;
+}
 
+int video_display_set_layout(enum video_display_layout new_layout) {
+	if(new_layout != DISPLAY_LAYOUT_GRID && new_layout != DISPLAY_LAYOUT_PIP)
+		return -1;
+	pthread_mutex_lock(&mutex_tiles);
+	layout = new_layout;
+	size_changed = 1;
+	pthread_mutex_unlock(&mutex_tiles);
 	return 0;
 }
 
@@ -307,7 +623,49 @@ SDL_Texture* video_make_text(char* text, int* res_w, int* res_h)
 	return text_tex;
 }
 
-void update_infos()
+int update_infos()
+{
+	//check whether there's new stuff in the input com buffer
+	double new_update = jakopter_com_get_timestamp(com_in);
+	if(new_update <= prev_update)
+		return 0;
+	prev_update = new_update;
+
+	//retrieve all the infos at once
+	jakopter_display_infos_t infos;
+	if(jakopter_com_read_buf(com_in, 0, sizeof(infos), &infos) == NULL)
+		return 0;
+	video_display_hud_t hud;
+	hud.bat = infos.battery;
+	hud.alt = infos.altitude;
+	hud.pitch = infos.pitch;
+	hud.roll = infos.roll;
+	hud.yaw = infos.yaw;
+	hud.speed = infos.speed;
+	video_display_set_hud(0, &hud);
+
+	//check if the user wants a screenshot
+	if(infos.screenshot) {
+		//copy the frame, the submitting threads mustn't wait for the file to be written
+		uint8_t* copy = NULL;
+		int size = 0;
+		pthread_mutex_lock(&mutex_tiles);
+		if(tiles[0].active && (copy = malloc(tiles[0].size)) != NULL) {
+			memcpy(copy, tiles[0].pixels, tiles[0].size);
+			size = tiles[0].size;
+		}
+		pthread_mutex_unlock(&mutex_tiles);
+		if(copy != NULL)
+			take_screenshot(copy, size);
+		free(copy);
+		jakopter_com_write_int(com_in, offsetof(jakopter_display_infos_t, screenshot), 0);
+		//don't take our own write for an update
+		prev_update = jakopter_com_get_timestamp(com_in);
+	}
+	return 1;
+}
+
+void update_hud_text(display_tile_t* tile)
 {
 	//base y position of the text
 	int base_y = 0;
@@ -315,79 +673,84 @@ void update_infos()
 	int line_height = TTF_FontLineSkip(font);
 	//buffer to hold the current textto be drawn
 	char buf[TEXT_BUF_SIZE];
+	int i=0;
+
+	for(i=0 ; i<VIDEO_NB_NAV_INFOS ; i++)
+		if(tile->graphs[i].tex != NULL)
+			SDL_DestroyTexture(tile->graphs[i].tex);
 
-	//retrieve navdata one by one
-	int bat = jakopter_com_read_int(com_in, 0);
-	//and format it for textual display
-	snprintf(buf, TEXT_BUF_SIZE, "Battery : %d%%", bat);
+	//format the battery level for textual display
+	snprintf(buf, TEXT_BUF_SIZE, "Battery : %d%%", tile->shown_hud.bat);
 	buf[TEXT_BUF_SIZE-1] = '\0';
-	//finally, print it onto a texture using SDL_ttf
-	graphs[0].tex = video_make_text(buf, &graphs[0].pos.w, &graphs[0].pos.h);
-	//and set its draw position accordingly
-	graphs[0].pos.x = 0;
-	graphs[0].pos.y = base_y;
+	//print it onto a texture using SDL_ttf
+	tile->graphs[VIDEO_BAT].tex = video_make_text(buf, &tile->graphs[VIDEO_BAT].pos.w, &tile->graphs[VIDEO_BAT].pos.h);
+	//and set its draw position, relative to the tile
+	tile->graphs[VIDEO_BAT].pos.x = 0;
+	tile->graphs[VIDEO_BAT].pos.y = base_y;
 	//go to a new line
 	base_y += line_height;
 
-	int alt = jakopter_com_read_int(com_in, 4);
-	snprintf(buf, TEXT_BUF_SIZE, "Altitude : %d", alt);
+	snprintf(buf, TEXT_BUF_SIZE, "Altitude : %d", tile->shown_hud.alt);
 	buf[TEXT_BUF_SIZE-1] = '\0';
-	graphs[1].tex = video_make_text(buf, &graphs[1].pos.w, &graphs[1].pos.h);
-	graphs[1].pos.x = 0;
-	graphs[1].pos.y = base_y;
-
-	//update pitch, roll, yaw and speed
-	pitch = jakopter_com_read_float(com_in, 8);
-	roll = jakopter_com_read_float(com_in, 12);
-	yaw = jakopter_com_read_float(com_in, 16);
-	speed = jakopter_com_read_float(com_in, 20);
-	//check if the user wants a screenshot
-	want_screenshot = jakopter_com_read_int(com_in, 24);
+	tile->graphs[VIDEO_ALT].tex = video_make_text(buf, &tile->graphs[VIDEO_ALT].pos.w, &tile->graphs[VIDEO_ALT].pos.h);
+	tile->graphs[VIDEO_ALT].pos.x = 0;
+	tile->graphs[VIDEO_ALT].pos.y = base_y;
 }
 
-void draw_attitude_indic()
+void draw_attitude_indic(const display_tile_t* tile)
 {
 	/*
 	* simple attitude indicator with the horizon represented by a straight line
 	* and the drone by a line with a center point.
 	*/
 	int i=0;
+	//the indicator is scaled along with the tile
+	float scale = tile->rect.w / 640.f;
+	int size = horiz_size * scale;
+	int posx = tile->rect.x + tile->rect.w/2 - size/2;
+	int posy = tile->rect.y + tile->rect.h - horiz_pitchScale*180*scale;
 	//nose inclination = y offset from the horizon
-	int nose_incl = (int)(horiz_pitchScale * pitch);
+	int nose_incl = (int)(horiz_pitchScale * scale * tile->shown_hud.pitch);
 	//"center" of the drone, unaffected by roll
-	SDL_Point center = {horiz_posx + horiz_size/2, horiz_posy-nose_incl};
+	SDL_Point center = {posx + size/2, posy-nose_incl};
 	//series of points representing the drone on the indicator, affected by pitch
 	SDL_Point drone_points[] = {
-		{horiz_posx, center.y},
+		{posx, center.y},
 		{center.x-5, center.y},
 		{center.x, center.y-5},
 		{center.x+5, center.y},
-		{horiz_posx+horiz_size, center.y}
+		{posx+size, center.y}
 	};
 	int nb_points = sizeof(drone_points)/sizeof(SDL_Point);
 	//apply roll to the points
 	for(i=0; i<nb_points; i++)
-		rotate_point(&drone_points[i], &center, roll);
+		rotate_point(&drone_points[i], &center, tile->shown_hud.roll);
 	//1. draw the horizon
-	SDL_RenderDrawLine(renderer, horiz_posx, horiz_posy, horiz_posx+horiz_size, horiz_posy);
+	SDL_RenderDrawLine(renderer, posx, posy, posx+size, posy);
 	//2. draw the drone's "flight line"
 	SDL_RenderDrawLines(renderer, drone_points, nb_points);
 }
 
-void draw_compass()
+void draw_compass(const display_tile_t* tile)
 {
 	/*draw every vertical bar of the compass.
 	Their position reflects the drone's yaw value.*/
 	int i=0;
-	int bar_interval = compass_w/compass_nbBars;
+	float scale = tile->rect.w / 640.f;
+	int width = compass_w * scale, height = compass_h * scale;
+	int x0 = tile->rect.x + tile->rect.w/2 - (int)(horiz_size*scale)/2;
+	int y0 = tile->rect.y + tile->rect.h - height*1.5;
+	int bar_interval = width/compass_nbBars;
+	if(bar_interval <= 0)
+		return;
 	//yaw displacement in pixels.
-	int offset = ((int)ceilf(yaw*compass_scale)) % bar_interval;
+	int offset = ((int)ceilf(tile->shown_hud.yaw*compass_scale*scale)) % bar_interval;
 	//consider negative offsets (=substraction from the interval)
 	offset = (bar_interval+offset)%bar_interval;
 	//compute the position of each bar, and render them
 	for(i=0; i<compass_nbBars; i++) {
-		int x = compass_x + offset + i*bar_interval;
-		SDL_RenderDrawLine(renderer, x, compass_y, x, compass_y+compass_h);
+		int x = x0 + offset + i*bar_interval;
+		SDL_RenderDrawLine(renderer, x, y0, x, y0+height);
 	}
 }
 
@@ -431,4 +794,3 @@ void take_screenshot(uint8_t* frame, int size)
 	free(filename);
 	screenshot_nb++;
 }
-
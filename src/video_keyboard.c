@@ -0,0 +1,221 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include "common.h"
+#include "video_keyboard.h"
+#include "drone.h"
+#include "navdata.h"
+#include "clock_sync.h"
+
+/**
+* Movement axes, in the order of jakopter_set_move's arguments.
+*/
+enum keyboard_axis {
+	KEY_ROLL,
+	KEY_PITCH,
+	KEY_VERTICAL,
+	KEY_YAW,
+	KEY_NB_AXES
+};
+
+/**
+* Actions that block until the drone has reacted,
+* run in their own thread so that the window stays responsive.
+*/
+enum keyboard_action {
+	KEY_ACTION_TAKEOFF,
+	KEY_ACTION_LAND,
+	KEY_ACTION_EMERGENCY
+};
+
+//for each axis, the key that makes it go negative, then positive.
+//negative pitch = forward.
+static const SDL_Scancode axis_keys[KEY_NB_AXES][2] = {
+	{SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT},
+	{SDL_SCANCODE_UP, SDL_SCANCODE_DOWN},
+	{SDL_SCANCODE_S, SDL_SCANCODE_W},
+	{SDL_SCANCODE_A, SDL_SCANCODE_D}
+};
+
+//state of the keys of each axis
+static int held[KEY_NB_AXES][2];
+//current setpoint
+static float speeds[KEY_NB_AXES];
+//time of the last ramp step, in ms
+static double last_update = 0;
+//time of the oldest input not written to the command slot yet, < 0 if none
+static double pending_input = -1;
+//set when the setpoint has to be written again
+static int dirty = 0;
+static int enabled = 1;
+static float max_speed = KEYBOARD_MAX_SPEED;
+static float accel = KEYBOARD_ACCEL;
+static pthread_mutex_t mutex_keyboard = PTHREAD_MUTEX_INITIALIZER;
+//set while a takeoff or a landing is in progress, protected by mutex_keyboard
+static int action_running = 0;
+
+
+static void keyboard_action_done()
+{
+	pthread_mutex_lock(&mutex_keyboard);
+	action_running = 0;
+	pthread_mutex_unlock(&mutex_keyboard);
+}
+
+static void* keyboard_action_routine(void* args)
+{
+	switch ((intptr_t)args) {
+		case KEY_ACTION_TAKEOFF:
+			jakopter_takeoff();
+			keyboard_action_done();
+			break;
+		case KEY_ACTION_LAND:
+			jakopter_land();
+			keyboard_action_done();
+			break;
+		case KEY_ACTION_EMERGENCY:
+			jakopter_emergency();
+			break;
+		default:
+			break;
+	}
+	pthread_exit(NULL);
+}
+
+static void keyboard_start_action(int action)
+{
+	pthread_t thread;
+	pthread_attr_t attribs;
+	pthread_attr_init(&attribs);
+	pthread_attr_setdetachstate(&attribs, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attribs, keyboard_action_routine, (void*)(intptr_t)action) < 0) {
+		perror("[keyboard] Can't create the action thread");
+		if (action != KEY_ACTION_EMERGENCY)
+			keyboard_action_done();
+	}
+	pthread_attr_destroy(&attribs);
+}
+
+void video_keyboard_key(int scancode, int down, int repeat, double time)
+{
+	int axis = 0, dir = 0;
+	//held keys are tracked here, the repetitions bring nothing new
+	if (repeat)
+		return;
+
+	pthread_mutex_lock(&mutex_keyboard);
+	if (!enabled) {
+		pthread_mutex_unlock(&mutex_keyboard);
+		return;
+	}
+	for (axis = 0; axis < KEY_NB_AXES; axis++)
+		for (dir = 0; dir < 2; dir++) {
+			if (axis_keys[axis][dir] != scancode)
+				continue;
+			held[axis][dir] = down;
+			//start moving right away, the ramp goes on from there
+			float sign = dir ? 1 : -1;
+			if (down && speeds[axis]*sign < KEYBOARD_START_SPEED)
+				speeds[axis] = sign * (KEYBOARD_START_SPEED < max_speed ? KEYBOARD_START_SPEED : max_speed);
+			dirty = 1;
+			if (pending_input < 0)
+				pending_input = time;
+		}
+	pthread_mutex_unlock(&mutex_keyboard);
+
+	if (!down)
+		return;
+	if (scancode == SDL_SCANCODE_ESCAPE)
+		keyboard_start_action(KEY_ACTION_EMERGENCY);
+	else if (scancode == SDL_SCANCODE_SPACE) {
+		//only one takeoff or landing at a time
+		pthread_mutex_lock(&mutex_keyboard);
+		int start = !action_running;
+		action_running = 1;
+		pthread_mutex_unlock(&mutex_keyboard);
+		if (start)
+			keyboard_start_action(jakopter_is_flying() ? KEY_ACTION_LAND : KEY_ACTION_TAKEOFF);
+	}
+}
+
+void video_keyboard_release_all()
+{
+	int axis = 0;
+	pthread_mutex_lock(&mutex_keyboard);
+	//nothing to send if the drone wasn't moved from the keyboard
+	for (axis = 0; axis < KEY_NB_AXES; axis++)
+		if (held[axis][0] || held[axis][1] || speeds[axis] != 0)
+			dirty = 1;
+	memset(held, 0, sizeof(held));
+	pthread_mutex_unlock(&mutex_keyboard);
+}
+
+int video_keyboard_update()
+{
+	float setpoint[KEY_NB_AXES];
+	int axis = 0, ramping = 0, write = 0;
+	double stamp = -1;
+	double now = jakopter_clock_host_now();
+	//don't jump after a long pause of the render thread
+	float dt = last_update > 0 && now - last_update < 100 ? (now - last_update)/1000 : 0;
+	last_update = now;
+
+	pthread_mutex_lock(&mutex_keyboard);
+	for (axis = 0; axis < KEY_NB_AXES && enabled; axis++) {
+		float target = (held[axis][1] - held[axis][0]) * max_speed;
+		if (speeds[axis] == target)
+			continue;
+		//speeding up in the same direction follows accel, anything else slows down first
+		int faster = target*speeds[axis] >= 0 && fabsf(target) > fabsf(speeds[axis]);
+		float step = (faster ? accel : KEYBOARD_DECEL) * dt;
+		if (faster && accel <= 0)
+			speeds[axis] = target;
+		else if (speeds[axis] < target)
+			speeds[axis] = speeds[axis] + step > target ? target : speeds[axis] + step;
+		else
+			speeds[axis] = speeds[axis] - step < target ? target : speeds[axis] - step;
+		dirty = 1;
+		ramping |= speeds[axis] != target;
+	}
+	if (dirty) {
+		memcpy(setpoint, speeds, sizeof(setpoint));
+		stamp = pending_input;
+		pending_input = -1;
+		dirty = 0;
+		write = enabled;
+	}
+	pthread_mutex_unlock(&mutex_keyboard);
+
+	if (write) {
+		if (stamp >= 0)
+			jakopter_input_stamp(stamp);
+		jakopter_set_move(setpoint[KEY_ROLL], setpoint[KEY_PITCH], setpoint[KEY_VERTICAL], setpoint[KEY_YAW]);
+	}
+	return ramping;
+}
+
+void jakopter_keyboard_enable(int enable)
+{
+	pthread_mutex_lock(&mutex_keyboard);
+	int was_enabled = enabled;
+	enabled = enable;
+	if (!enable) {
+		memset(held, 0, sizeof(held));
+		memset(speeds, 0, sizeof(speeds));
+		pending_input = -1;
+		dirty = 0;
+	}
+	pthread_mutex_unlock(&mutex_keyboard);
+
+	if (was_enabled && !enable)
+		jakopter_set_move(0, 0, 0, 0);
+}
+
+void jakopter_keyboard_set_ramp(float new_max_speed, float new_accel)
+{
+	if (new_max_speed <= 0 || new_max_speed > 1)
+		return;
+	pthread_mutex_lock(&mutex_keyboard);
+	max_speed = new_max_speed;
+	accel = new_accel;
+	pthread_mutex_unlock(&mutex_keyboard);
+}
@@ -0,0 +1,323 @@
+#include <libavformat/avformat.h>
+#include "video_offline.h"
+#include "video_decode.h"
+#include "video_quality.h"
+
+//initial capacity of the packet and GOP arrays, doubled when full
+#define OFFLINE_BASE_CAPACITY 64
+
+/**
+* A group of pictures : a keyframe and the packets depending on it.
+* It can be decoded independently of the others.
+*/
+typedef struct offline_gop {
+	AVPacket* packets;
+	int nb_packets;
+	int capacity;
+	//index of the GOP's first frame in the file
+	int first_frame;
+} offline_gop_t;
+
+/**
+* State shared by the worker threads.
+*/
+typedef struct offline_job {
+	offline_gop_t* gops;
+	int nb_gops;
+	int nb_frames;
+	//index of the next GOP to hand out to a worker
+	int next_gop;
+	//set when a callback or a decoder fails, every worker stops then.
+	int aborted;
+	pthread_mutex_t mutex;
+	//decoder parameters, copied from the demuxer's stream
+	AVCodecContext* stream_context;
+	AVCodec* codec;
+	video_offline_callback callback;
+	size_t result_size;
+	uint8_t* results;
+	void* user;
+} offline_job_t;
+
+static int offline_add_packet(offline_gop_t* gop, AVPacket* packet)
+{
+	if(gop->nb_packets == gop->capacity) {
+		int capacity = gop->capacity ? gop->capacity*2 : OFFLINE_BASE_CAPACITY;
+		AVPacket* packets = realloc(gop->packets, capacity*sizeof(AVPacket));
+		if(packets == NULL)
+			return -1;
+		gop->packets = packets;
+		gop->capacity = capacity;
+	}
+	//make sure the packet owns its data, since the demuxer reuses its buffers
+	if(av_dup_packet(packet) < 0)
+		return -1;
+	gop->packets[gop->nb_packets++] = *packet;
+	return 0;
+}
+
+static void offline_free_gops(offline_gop_t* gops, int nb_gops)
+{
+	int i=0, j=0;
+	for(i=0 ; i<nb_gops ; i++) {
+		for(j=0 ; j<gops[i].nb_packets ; j++)
+			av_free_packet(&gops[i].packets[j]);
+		free(gops[i].packets);
+	}
+	free(gops);
+}
+
+/**
+* Read all the video packets of the file, and split them at keyframes.
+* Packets before the first keyframe can't be decoded, they are dropped.
+* \returns 0 on success, -1 on error.
+*/
+static int offline_split_gops(AVFormatContext* format, int stream, offline_job_t* job)
+{
+	AVPacket packet;
+	int capacity = 0;
+	job->gops = NULL;
+	job->nb_gops = 0;
+	job->nb_frames = 0;
+
+	av_init_packet(&packet);
+	while(av_read_frame(format, &packet) >= 0) {
+		if(packet.stream_index != stream || (job->nb_gops == 0 && !(packet.flags & AV_PKT_FLAG_KEY))) {
+			av_free_packet(&packet);
+			continue;
+		}
+		//a keyframe starts a new GOP
+		if(packet.flags & AV_PKT_FLAG_KEY) {
+			if(job->nb_gops == capacity) {
+				capacity = capacity ? capacity*2 : OFFLINE_BASE_CAPACITY;
+				offline_gop_t* gops = realloc(job->gops, capacity*sizeof(offline_gop_t));
+				if(gops == NULL) {
+					av_free_packet(&packet);
+					return -1;
+				}
+				job->gops = gops;
+			}
+			memset(&job->gops[job->nb_gops], 0, sizeof(offline_gop_t));
+			job->gops[job->nb_gops].first_frame = job->nb_frames;
+			job->nb_gops++;
+		}
+		if(offline_add_packet(&job->gops[job->nb_gops-1], &packet) < 0) {
+			av_free_packet(&packet);
+			return -1;
+		}
+		job->nb_frames++;
+	}
+	return 0;
+}
+
+/**
+* Lay out a decoded frame, score it, and run the callback on it if it passes the quality filter.
+* \param damaged set if the decoder failed earlier in the GOP.
+* \returns the callback's return value, or -1 on error.
+*/
+static int offline_process_frame(offline_job_t* job, AVFrame* frame, int index, int damaged,
+	uint8_t** buffer, int* buffer_size, uint8_t** scratch, size_t* scratch_size)
+{
+	int size = avpicture_get_size(frame->format, frame->width, frame->height);
+	if(size > *buffer_size) {
+		uint8_t* new_buffer = realloc(*buffer, size);
+		if(new_buffer == NULL)
+			return -1;
+		*buffer = new_buffer;
+		*buffer_size = size;
+	}
+	jakopter_video_frame_t result;
+	result.w = frame->width;
+	result.h = frame->height;
+	result.size = avpicture_layout((const AVPicture*)frame, frame->format,
+		frame->width, frame->height, *buffer, *buffer_size);
+	result.pixels = *buffer;
+	result.quality.decode_error = damaged;
+	result.received = -1;
+	video_quality_compute(&result, scratch, scratch_size);
+	if(!video_quality_check(&result.quality))
+		return 0;
+
+	void* frame_result = job->results ? job->results + index*job->result_size : NULL;
+	return job->callback(&result, index, frame_result, job->user);
+}
+
+/**
+* Decode a whole GOP, and process its frames.
+* Frames come out of the decoder in display order, their index follows this order.
+* A packet that fails to decode still counts as a frame : its index is skipped,
+* and the frames after it in the GOP are marked damaged.
+* \returns 0 on success, -1 on error.
+*/
+static int offline_decode_gop(offline_job_t* job, AVCodecContext* context, AVFrame* frame,
+	const offline_gop_t* gop, uint8_t** buffer, int* buffer_size, uint8_t** scratch, size_t* scratch_size)
+{
+	int i=0, got_frame=0, damaged=0;
+	int index = gop->first_frame;
+	int last = gop->first_frame + gop->nb_packets;
+	AVPacket flush_packet;
+	av_init_packet(&flush_packet);
+	flush_packet.data = NULL;
+	flush_packet.size = 0;
+
+	//the extra iterations drain the frames delayed by the decoder
+	for(i=0 ; i<gop->nb_packets || got_frame ; i++) {
+		const AVPacket* packet = i < gop->nb_packets ? &gop->packets[i] : &flush_packet;
+		got_frame = 0;
+		if(avcodec_decode_video2(context, frame, &got_frame, packet) < 0) {
+			//a broken frame shouldn't prevent the rest of the GOP from being processed
+			fprintf(stderr, "[Video offline] couldn't decode frame %d.\n", index);
+			damaged = 1;
+			//the lost frame keeps its slot, so that the next ones stay at their index
+			if(i < gop->nb_packets)
+				index++;
+			continue;
+		}
+		if(got_frame) {
+			if(index < last && offline_process_frame(job, frame, index, damaged, buffer, buffer_size, scratch, scratch_size) < 0) {
+				av_frame_unref(frame);
+				return -1;
+			}
+			index++;
+			av_frame_unref(frame);
+		}
+	}
+	//the next GOP must not reference this one
+	avcodec_flush_buffers(context);
+	return 0;
+}
+
+static void* offline_worker(void* args)
+{
+	offline_job_t* job = args;
+	uint8_t* buffer = NULL;
+	int buffer_size = 0;
+	//half resolution luma for the quality metrics
+	uint8_t* scratch = NULL;
+	size_t scratch_size = 0;
+
+	//each worker has its own decoder; parallelism happens between GOPs
+	int ready = 0;
+	AVCodecContext* context = avcodec_alloc_context3(job->codec);
+	AVFrame* frame = av_frame_alloc();
+	if(context == NULL || frame == NULL || avcodec_copy_context(context, job->stream_context) < 0)
+		fprintf(stderr, "[Video offline] couldn't create a decoder.\n");
+	else {
+		context->thread_count = 1;
+		if(avcodec_open2(context, job->codec, NULL) < 0)
+			fprintf(stderr, "[Video offline] couldn't open codec.\n");
+		else
+			ready = 1;
+	}
+
+	pthread_mutex_lock(&job->mutex);
+	if(!ready)
+		job->aborted = 1;
+	while(!job->aborted && job->next_gop < job->nb_gops) {
+		const offline_gop_t* gop = &job->gops[job->next_gop++];
+		pthread_mutex_unlock(&job->mutex);
+
+		int ret = offline_decode_gop(job, context, frame, gop, &buffer, &buffer_size, &scratch, &scratch_size);
+
+		pthread_mutex_lock(&job->mutex);
+		if(ret < 0)
+			job->aborted = 1;
+	}
+	pthread_mutex_unlock(&job->mutex);
+
+	if(context != NULL) {
+		avcodec_close(context);
+		av_free(context);
+	}
+	av_frame_free(&frame);
+	free(buffer);
+	free(scratch);
+	pthread_exit(NULL);
+}
+
+int jakopter_video_process_file(const char* path, int nb_workers, video_offline_callback callback,
+	size_t result_size, void** results, void* user)
+{
+	AVFormatContext* format = NULL;
+	offline_job_t job;
+	memset(&job, 0, sizeof(job));
+
+	if(callback == NULL)
+		return -1;
+
+	av_register_all();
+	av_log_set_level(JAKO_FFMPEG_LOG);
+	if(avformat_open_input(&format, path, NULL, NULL) < 0) {
+		fprintf(stderr, "[Video offline] couldn't open %s\n", path);
+		return -1;
+	}
+	if(avformat_find_stream_info(format, NULL) < 0) {
+		fprintf(stderr, "[Video offline] couldn't read stream info from %s\n", path);
+		avformat_close_input(&format);
+		return -1;
+	}
+	int stream = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &job.codec, 0);
+	if(stream < 0 || job.codec == NULL) {
+		fprintf(stderr, "[Video offline] no decodable video stream in %s\n", path);
+		avformat_close_input(&format);
+		return -1;
+	}
+	job.stream_context = format->streams[stream]->codec;
+
+	if(offline_split_gops(format, stream, &job) < 0) {
+		fprintf(stderr, "[Video offline] couldn't allocate memory for the stream.\n");
+		offline_free_gops(job.gops, job.nb_gops);
+		avformat_close_input(&format);
+		return -1;
+	}
+
+	if(results != NULL && result_size > 0) {
+		job.results = calloc(job.nb_frames > 0 ? job.nb_frames : 1, result_size);
+		if(job.results == NULL) {
+			fprintf(stderr, "[Video offline] couldn't allocate memory for the results.\n");
+			offline_free_gops(job.gops, job.nb_gops);
+			avformat_close_input(&format);
+			return -1;
+		}
+	}
+	job.result_size = result_size;
+	job.callback = callback;
+	job.user = user;
+	pthread_mutex_init(&job.mutex, NULL);
+
+	if(nb_workers <= 0)
+		nb_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if(nb_workers > job.nb_gops)
+		nb_workers = job.nb_gops > 0 ? job.nb_gops : 1;
+
+	pthread_t* workers = malloc(nb_workers*sizeof(pthread_t));
+	int nb_started = 0;
+	if(workers != NULL)
+		for(nb_started=0 ; nb_started<nb_workers ; nb_started++)
+			if(pthread_create(&workers[nb_started], NULL, offline_worker, &job) < 0) {
+				perror("[Video offline] can't create worker thread");
+				break;
+			}
+	//the GOPs are handed out dynamically, so fewer workers is only slower
+	if(nb_started == 0)
+		job.aborted = 1;
+	int i=0;
+	for(i=0 ; i<nb_started ; i++)
+		pthread_join(workers[i], NULL);
+	free(workers);
+
+	pthread_mutex_destroy(&job.mutex);
+	offline_free_gops(job.gops, job.nb_gops);
+	avformat_close_input(&format);
+
+	if(job.aborted) {
+		fprintf(stderr, "[Video offline] processing of %s aborted.\n", path);
+		free(job.results);
+		return -1;
+	}
+	printf("[Video offline] %d frames in %d GOPs processed with %d workers.\n",
+		job.nb_frames, job.nb_gops, nb_started);
+	if(results != NULL)
+		*results = job.results;
+	return job.nb_frames;
+}
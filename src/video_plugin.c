@@ -0,0 +1,29 @@
+#include "plugin.h"
+#include "video_quality.h"
+#ifdef WITH_VIDEO_CLIP
+#include "video_clip.h"
+#endif
+
+/*
+Table of the video module, looked up by the core when the video is first used.
+*/
+JAKOPTER_PLUGIN_EXPORT const jakopter_video_plugin_t jakopter_video_plugin = {
+	.version = JAKOPTER_PLUGIN_VERSION,
+	.init_video = jakopter_init_video,
+	.stop_video = jakopter_stop_video,
+	.set_camera = jakopter_video_set_camera,
+	.get_switch_latency = jakopter_video_get_switch_latency,
+	.lock_frame = jakopter_video_lock_frame,
+	.unlock_frame = jakopter_video_unlock_frame,
+	.get_quality = jakopter_video_get_quality,
+	.latency = jakopter_video_latency,
+	.quality_filter = jakopter_video_quality_filter,
+#ifdef WITH_VIDEO_OFFLINE
+	.process_file = jakopter_video_process_file,
+#endif
+#ifdef WITH_VIDEO_CLIP
+	.clip = jakopter_video_clip,
+	.clip_on_state = jakopter_video_clip_on_state,
+	.clip_navdata_state = video_clip_navdata_state,
+#endif
+};
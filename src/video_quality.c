@@ -0,0 +1,141 @@
+#include "video_quality.h"
+
+//the filter lets everything through by default
+static float filter_sharpness = 0, filter_clipped = 1, filter_corruption = 1;
+static pthread_mutex_t mutex_filter = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+* Average 2x2 blocks of the luma plane.
+*/
+static void quality_downsample(const uint8_t* luma, int w, uint8_t* half, int hw, int hh)
+{
+	int x = 0, y = 0;
+	for(y = 0 ; y < hh ; y++) {
+		const uint8_t* row0 = luma + 2*y*w;
+		const uint8_t* row1 = row0 + w;
+		uint8_t* out = half + y*hw;
+		for(x = 0 ; x < hw ; x++)
+			out[x] = (row0[2*x] + row0[2*x+1] + row1[2*x] + row1[2*x+1] + 2) >> 2;
+	}
+}
+
+/**
+* Sum and sum of squares of the Laplacian on the inner pixels of a row,
+* from x = start to end excluded.
+*/
+static void quality_laplacian_row(const uint8_t* up, const uint8_t* row, const uint8_t* down,
+	int start, int end, int64_t* sum, int64_t* sum_sq)
+{
+	int32_t row_sum = 0;
+	uint32_t row_sq = 0;
+	int x = 0;
+	for(x = start ; x < end ; x++) {
+		int32_t lap = 4*row[x] - row[x-1] - row[x+1] - up[x] - down[x];
+		row_sum += lap;
+		row_sq += lap*lap;
+	}
+	*sum += row_sum;
+	*sum_sq += row_sq;
+}
+
+/**
+* Sum of the absolute differences between neighbours of a row, from x = start to end excluded.
+*/
+static uint32_t quality_gradient_row(const uint8_t* row, int start, int end)
+{
+	uint32_t total = 0;
+	int x = 0;
+	for(x = start ; x < end ; x++)
+		total += abs(row[x] - row[x-1]);
+	return total;
+}
+
+int video_quality_compute(jakopter_video_frame_t* frame, uint8_t** scratch, size_t* scratch_size)
+{
+	int decode_error = frame->quality.decode_error;
+	memset(&frame->quality, 0, sizeof(frame->quality));
+	frame->quality.decode_error = decode_error;
+
+	int hw = frame->w / 2, hh = frame->h / 2;
+	if(frame->pixels == NULL || hw < 3 || hh < 3 || frame->size < (size_t)frame->w*frame->h)
+		return -1;
+	size_t needed = (size_t)hw*hh;
+	if(needed > *scratch_size) {
+		uint8_t* buffer = realloc(*scratch, needed);
+		if(buffer == NULL) {
+			fprintf(stderr, "[Video Quality] Couldn't allocate memory\n");
+			return -1;
+		}
+		*scratch = buffer;
+		*scratch_size = needed;
+	}
+	uint8_t* half = *scratch;
+	quality_downsample(frame->pixels, frame->w, half, hw, hh);
+
+	int x = 0, y = 0, i = 0;
+	//histogram and brightness
+	uint32_t histogram[VIDEO_QUALITY_BINS] = {0};
+	uint64_t brightness = 0;
+	for(i = 0 ; i < needed ; i++)
+		brightness += half[i];
+	for(i = 0 ; i < needed ; i++)
+		histogram[half[i] * VIDEO_QUALITY_BINS / 256]++;
+	for(i = 0 ; i < VIDEO_QUALITY_BINS ; i++)
+		frame->quality.histogram[i] = (float)histogram[i] / needed;
+	frame->quality.brightness = (float)brightness / needed;
+	frame->quality.underexposed = frame->quality.histogram[0];
+	frame->quality.overexposed = frame->quality.histogram[VIDEO_QUALITY_BINS-1];
+
+	//sharpness, and gradients across and inside the macroblock grid
+	int64_t lap_sum = 0, lap_sq = 0;
+	uint64_t grad_all = 0, grad_grid = 0;
+	for(y = 0 ; y < hh ; y++) {
+		const uint8_t* row = half + y*hw;
+		int start = 1;
+		for(start = 1 ; start < hw ; start += VIDEO_QUALITY_CHUNK) {
+			int end = start + VIDEO_QUALITY_CHUNK < hw ? start + VIDEO_QUALITY_CHUNK : hw;
+			grad_all += quality_gradient_row(row, start, end);
+			if(y > 0 && y < hh-1)
+				quality_laplacian_row(row - hw, row, row + hw, start, end < hw-1 ? end : hw-1, &lap_sum, &lap_sq);
+		}
+		for(x = VIDEO_QUALITY_BLOCK ; x < hw ; x += VIDEO_QUALITY_BLOCK)
+			grad_grid += abs(row[x] - row[x-1]);
+	}
+	int64_t nb_lap = (int64_t)(hw-2)*(hh-2);
+	double lap_mean = (double)lap_sum / nb_lap;
+	frame->quality.sharpness = (double)lap_sq / nb_lap - lap_mean*lap_mean;
+
+	int nb_grid = (hw-1) / VIDEO_QUALITY_BLOCK * hh;
+	int nb_inner = (hw-1) * hh - nb_grid;
+	if(nb_grid > 0 && nb_inner > 0) {
+		float ratio = ((float)grad_grid / nb_grid + 1) / ((float)(grad_all - grad_grid) / nb_inner + 1);
+		float blockiness = (ratio - 1) / (VIDEO_QUALITY_BLOCKY_RATIO - 1);
+		frame->quality.corruption = blockiness < 0 ? 0 : (blockiness > 1 ? 1 : blockiness);
+	}
+	if(decode_error)
+		frame->quality.corruption = 1;
+
+	frame->quality.valid = 1;
+	return 0;
+}
+
+int video_quality_check(jakopter_video_quality_t* quality)
+{
+	pthread_mutex_lock(&mutex_filter);
+	quality->passed = !quality->valid ||
+		(quality->sharpness >= filter_sharpness &&
+		quality->underexposed + quality->overexposed <= filter_clipped &&
+		quality->corruption <= filter_corruption);
+	pthread_mutex_unlock(&mutex_filter);
+	return quality->passed;
+}
+
+void jakopter_video_quality_filter(float min_sharpness, float max_clipped, float max_corruption)
+{
+	pthread_mutex_lock(&mutex_filter);
+	filter_sharpness = min_sharpness;
+	filter_clipped = max_clipped;
+	filter_corruption = max_corruption;
+	pthread_mutex_unlock(&mutex_filter);
+}
@@ -52,6 +52,12 @@ void video_queue_push_frame(const jakopter_video_frame_t* frame)
 	pthread_mutex_unlock(&mutex);
 }
 
+void video_queue_flush()
+{
+	pthread_mutex_lock(&mutex);
+	isEmpty = true;
+	pthread_mutex_unlock(&mutex);
+}
 
 int video_queue_pull_frame(jakopter_video_frame_t* dest)
 {
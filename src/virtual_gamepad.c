@@ -0,0 +1,181 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/uinput.h>
+
+/*
+* Virtual gamepad, to try the joystick control without a real one.
+* Creates a gamepad through uinput (needs write access to /dev/uinput),
+* prints the path of its event device, then plays a short flight :
+* takeoff, forward, yaw, landing, with an emergency press in the middle
+* of the landing if -e is given.
+* Usage : virtual_gamepad [-e] [-w seconds before starting]
+*/
+
+#define UINPUT_PATH "/dev/uinput"
+#define GAMEPAD_NAME "jakopter virtual gamepad"
+#define AXIS_MIN -32768
+#define AXIS_MAX 32767
+
+static volatile sig_atomic_t running = 1;
+static int fd = -1;
+
+static void stop_handler(int sig)
+{
+	running = 0;
+}
+
+static void sleep_ms(int ms)
+{
+	struct timespec t = {ms / 1000, (ms % 1000) * 1000000L};
+	while (running && nanosleep(&t, &t) < 0 && errno == EINTR);
+}
+
+static void emit(int type, int code, int value)
+{
+	struct input_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	if (write(fd, &ev, sizeof(ev)) != sizeof(ev))
+		perror("[virtual_gamepad] write");
+}
+
+static void sync_events()
+{
+	emit(EV_SYN, SYN_REPORT, 0);
+}
+
+static void press(int button)
+{
+	printf("[virtual_gamepad] press %s\n", button == BTN_START ? "START (takeoff)" :
+		button == BTN_SELECT ? "SELECT (land)" : "MODE (emergency)");
+	emit(EV_KEY, button, 1);
+	sync_events();
+	sleep_ms(100);
+	emit(EV_KEY, button, 0);
+	sync_events();
+}
+
+/**
+* Move a stick axis, value in [-1, 1].
+*/
+static void stick(int code, float value)
+{
+	emit(EV_ABS, code, (int)(value * AXIS_MAX));
+	sync_events();
+}
+
+static int create_gamepad()
+{
+	fd = open(UINPUT_PATH, O_WRONLY | O_NONBLOCK);
+	if (fd < 0) {
+		perror("[virtual_gamepad] Can't open " UINPUT_PATH);
+		return -1;
+	}
+
+	int buttons[] = {BTN_SOUTH, BTN_START, BTN_SELECT, BTN_MODE};
+	int axes[] = {ABS_X, ABS_Y, ABS_RX, ABS_RY};
+	unsigned int i = 0;
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	for (i = 0; i < sizeof(buttons)/sizeof(buttons[0]); i++)
+		ioctl(fd, UI_SET_KEYBIT, buttons[i]);
+	ioctl(fd, UI_SET_EVBIT, EV_ABS);
+
+	struct uinput_user_dev dev;
+	memset(&dev, 0, sizeof(dev));
+	snprintf(dev.name, UINPUT_MAX_NAME_SIZE, GAMEPAD_NAME);
+	dev.id.bustype = BUS_VIRTUAL;
+	for (i = 0; i < sizeof(axes)/sizeof(axes[0]); i++) {
+		ioctl(fd, UI_SET_ABSBIT, axes[i]);
+		dev.absmin[axes[i]] = AXIS_MIN;
+		dev.absmax[axes[i]] = AXIS_MAX;
+	}
+
+	if (write(fd, &dev, sizeof(dev)) != sizeof(dev) || ioctl(fd, UI_DEV_CREATE) < 0) {
+		perror("[virtual_gamepad] Can't create the device");
+		close(fd);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+* Print the event device created for the gamepad, to give it to jakopter_joystick_connect.
+*/
+static void print_device()
+{
+	char sysname[64];
+	if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+		printf("[virtual_gamepad] device created, look for \"%s\" in /proc/bus/input/devices\n", GAMEPAD_NAME);
+		return;
+	}
+	//the event node is the eventX entry of the input device in sysfs
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/virtual/input/%s", sysname);
+	DIR* dir = opendir(path);
+	struct dirent* entry = NULL;
+	while (dir != NULL && (entry = readdir(dir)) != NULL)
+		if (strncmp(entry->d_name, "event", 5) == 0)
+			break;
+	if (entry != NULL)
+		printf("[virtual_gamepad] device : /dev/input/%s\n", entry->d_name);
+	else
+		printf("[virtual_gamepad] device : see %s\n", path);
+	if (dir != NULL)
+		closedir(dir);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	int emergency = 0, wait = 5, opt;
+	while ((opt = getopt(argc, argv, "ew:")) != -1) {
+		switch (opt) {
+			case 'e': emergency = 1; break;
+			case 'w': wait = atoi(optarg); break;
+			default:
+				fprintf(stderr, "Usage : %s [-e] [-w seconds]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	signal(SIGINT, stop_handler);
+	signal(SIGTERM, stop_handler);
+	if (create_gamepad() < 0)
+		return 1;
+	print_device();
+	printf("[virtual_gamepad] starting in %d s\n", wait);
+	sleep_ms(wait * 1000);
+
+	press(BTN_START);
+	sleep_ms(6000);
+	printf("[virtual_gamepad] forward\n");
+	stick(ABS_RY, -0.5);
+	sleep_ms(2000);
+	stick(ABS_RY, 0);
+	printf("[virtual_gamepad] yaw right\n");
+	stick(ABS_X, 0.6);
+	sleep_ms(1500);
+	stick(ABS_X, 0);
+	sleep_ms(1000);
+	press(BTN_SELECT);
+	if (emergency) {
+		//the landing is still in progress : the emergency must not wait for it
+		sleep_ms(500);
+		press(BTN_MODE);
+	}
+	sleep_ms(6000);
+
+	ioctl(fd, UI_DEV_DESTROY);
+	close(fd);
+	return 0;
+}
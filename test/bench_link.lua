@@ -0,0 +1,120 @@
+--Link benchmark, to run through the netem proxy (see test/netem).
+--Prints every second how many navdata and video frames got through, how old
+--the navdata seen by the program are, the latency of the video frames and of
+--the user inputs, and how well the drone's clock is known. It also takes off
+--and lands to time the commands that depend on the link.
+--Compare the lines with the phases printed by netem to see how each impairment degrades them.
+--JAKOPTER_DRONE_IP=127.0.0.2 lua bench_link.lua [duration]
+--With LuaJIT and LUA_PATH="../lua/?.lua;;", the video is measured too.
+
+l=require("libjakopter")
+ok, jffi = pcall(require, "jakopter_ffi")
+if not ok then jffi = nil end
+
+duration = tonumber(arg and arg[1]) or 60
+--period of the simulated user inputs, in ms
+input_period = 500
+
+if jffi then l.connect_video() end
+if l.connect() < 0 then
+	print("connection failed")
+	os.exit(1)
+end
+
+start = l.host_now()
+second = start + 1000
+next_input = start
+input_dir = 1
+tt = 0
+last_nav = start
+nav_count = 0
+age_sum, age_max, age_samples = 0, 0, 0
+last_frame = 0
+frame_latency_count, frame_latency_sum = 0, 0
+input_count, input_sum = 0, 0
+nav_total = 0
+frame_total = 0
+print("time(s)  navdata/s  age mean/max(ms)  frames/s  frame latency(ms)  input latency(ms)  clock bound(ms)")
+
+--time a blocking command, in ms
+function timed(name, f)
+	local t = l.host_now()
+	local ret = f()
+	print(string.format("%s : %d, %.0f ms", name, ret, l.host_now() - t))
+end
+
+--mean of a cumulative statistic over the last second, from its mean and count
+function interval_mean(mean, count, prev_sum, prev_count)
+	if count <= prev_count then
+		return nil, mean * count
+	end
+	local sum = mean * count
+	return (sum - prev_sum) / (count - prev_count), sum
+end
+
+function format_ms(value)
+	return value and string.format("%.1f", value) or "-"
+end
+
+timed("takeoff", l.takeoff)
+
+while l.host_now() - start < duration * 1000 do
+	l.usleep(2000)
+	now = l.host_now()
+	tt_new = l.cc_get_timestamp(1)
+	if tt_new ~= tt then
+		tt = tt_new
+		nav_count = nav_count + 1
+		last_nav = now
+	end
+	--how old the latest navdata are, as seen by the program
+	age = now - last_nav
+	age_sum = age_sum + age
+	age_samples = age_samples + 1
+	if age > age_max then age_max = age end
+
+	--small yaw back and forth, stamped as user inputs
+	if now >= next_input then
+		l.set_move(0, 0, 0, 0.05 * input_dir)
+		input_dir = -input_dir
+		next_input = next_input + input_period
+	end
+
+	if now >= second then
+		frames = 0
+		frame_latency = nil
+		if jffi then
+			local ok, index = jffi.with_frame(function(frame, index) return index end)
+			if ok then
+				frames = index - last_frame
+				last_frame = index
+			end
+			local _, mean, _, count = l.video_latency()
+			frame_latency, frame_latency_sum = interval_mean(mean, count, frame_latency_sum, frame_latency_count)
+			frame_latency_count = count
+		end
+		local _, mean, _, count = l.input_latency()
+		input_latency, input_sum = interval_mean(mean, count, input_sum, input_count)
+		input_count = count
+		offset, drift, bound = l.clock_sync()
+		print(string.format("%6.0f  %9d  %16s  %8d  %17s  %17s  %15s", (second - start) / 1000, nav_count,
+			string.format("%.0f/%.0f", age_sum / math.max(age_samples, 1), age_max), frames,
+			format_ms(frame_latency), format_ms(input_latency), format_ms(bound)))
+		nav_total = nav_total + nav_count
+		frame_total = frame_total + frames
+		nav_count = 0
+		age_sum, age_max, age_samples = 0, 0, 0
+		second = second + 1000
+	end
+end
+
+l.set_move(0, 0, 0, 0)
+timed("land", l.land)
+print(string.format("total : %d navdata, %d frames in %d s", nav_total, frame_total, duration))
+local _, mean, max = l.input_latency()
+print(string.format("input latency : mean %.1f ms, max %.1f ms", mean, max))
+if jffi then
+	_, mean, max = l.video_latency()
+	print(string.format("frame latency : mean %.1f ms, max %.1f ms", mean, max))
+end
+l.disconnect()
@@ -0,0 +1,43 @@
+--Formation example for the fleet sender : every drone gets its commands
+--on the same tick, so the group moves together.
+--lua fleet.lua 192.168.1.10 192.168.1.11 [...]
+--The drones have to be on the same network, in station mode.
+
+l=require("libjakopter")
+
+ips = {...}
+if #ips == 0 then
+	print("usage : lua fleet.lua address [address ...]")
+	os.exit(1)
+end
+unpack = unpack or table.unpack
+if l.fleet_connect(unpack(ips)) < 0 then
+	print("fleet connection failed")
+	os.exit(1)
+end
+
+function wait(ms)
+	local t = l.host_now() + ms
+	while l.host_now() < t do l.usleep(10000) end
+end
+
+l.fleet_takeoff()
+wait(5000)
+--everyone forward, then the even drones left and the odd ones right
+l.fleet_move(0xFFFFFFFF, 0, -0.2, 0, 0)
+wait(1000)
+moves = {}
+for i = 0, #ips-1 do
+	moves[#moves+1] = {i, i % 2 == 0 and -0.2 or 0.2, 0, 0, 0}
+end
+l.fleet_moves(moves)
+wait(1000)
+l.fleet_move(0xFFFFFFFF, 0, 0, 0, 0)
+wait(1000)
+l.fleet_land()
+wait(3000)
+
+last, mean, max, late, ticks = l.fleet_skew()
+print(string.format("%d ticks, skew last %.1f us, mean %.1f us, max %.1f us, worst tick lateness %.1f us",
+	ticks, last, mean, max, late))
+l.fleet_disconnect()
@@ -0,0 +1,24 @@
+-- Fly with a gamepad, or with the virtual one of the virtual_gamepad program.
+-- Usage : lua joystick.lua [/dev/input/eventX] [seconds]
+local d = require("libjakopter")
+
+local device = arg[1]
+local duration = tonumber(arg[2]) or 30
+
+d.connect()
+if d.connect_joystick(device) < 0 then
+	print("No joystick")
+	d.disconnect()
+	return
+end
+
+local t = 0
+while t < duration do
+	print(string.format("%2ds flying : %d height : %d", t, d.is_flying(), d.height()))
+	d.usleep(1000000)
+	t = t + 1
+end
+
+d.stop_joystick()
+d.land()
+d.disconnect()
@@ -0,0 +1,29 @@
+--Movement commands check, against the drone stand-in : each setpoint below is
+--given with set_move, and the stand-in prints the speeds it decodes from the
+--AT*PCMD it receives. Both lists must match, signs included.
+--./drone_standin &
+--JAKOPTER_DRONE_IP=127.0.0.3 lua pcmd.lua
+
+l=require("libjakopter")
+
+setpoints = {
+	{-0.5, 0.5, -0.05, 0.05},
+	{-1, -1, -1, -1},
+	{0.25, -0.75, 0, -0.1},
+	{1, 1, 1, 1},
+	{0, 0, 0, 0}
+}
+
+if l.connect() < 0 then
+	print("connection failed")
+	os.exit(1)
+end
+
+for _, s in ipairs(setpoints) do
+	print(string.format("[pcmd] set_move %.3f %.3f %.3f %.3f", s[1], s[2], s[3], s[4]))
+	l.set_move(s[1], s[2], s[3], s[4])
+	--a few ticks of the command thread
+	l.usleep(200000)
+end
+
+l.disconnect()
@@ -0,0 +1,42 @@
+--Same as test_video.lua, using the FFI fast path (needs LuaJIT).
+--The FFI module is in the lua folder : run with
+--LUA_PATH="../lua/?.lua;;" luajit test_ffi.lua
+
+l=require("libjakopter")
+jffi=require("jakopter_ffi")
+l.connect_video()
+l.connect()
+
+nav = jffi.navdata()
+infos = jffi.display_infos()
+tt = 0
+tt_new = 0
+while true do
+	repeat
+		l.yield()
+		tt_new = jffi.timestamp(jffi.CHANNEL_NAVDATA)
+	until tt_new > tt
+	tt = tt_new
+
+	jffi.read_navdata(nav)
+	infos.battery = nav.battery
+	infos.altitude = nav.altitude
+	--angles en millidegrés, il faut les convertir en degrés.
+	infos.pitch = nav.theta / 1000
+	infos.roll = nav.phi / 1000
+	infos.yaw = nav.psi / 1000
+	jffi.write_hud(infos)
+
+	--luminosité moyenne de l'image (plan Y), lue directement en mémoire
+	ok, luma = jffi.with_frame(function(frame)
+		local sum = 0
+		local npix = frame.w * frame.h
+		for i = 0, npix - 1, 16 do
+			sum = sum + frame.pixels[i]
+		end
+		return sum * 16 / npix
+	end)
+	if ok then
+		print("luma", luma)
+	end
+end